@@ -0,0 +1,232 @@
+#include "chunkedformupload.h"
+#include <QTcpSocket>
+#include <QTimer>
+#include <QUuid>
+#include <QDebug>
+
+namespace {
+// 请求体结束后等待响应的时限（服务端需完成声纹注册）
+const int kResponseTimeoutMs = 30000;
+
+// 解码 chunked 响应体；数据不完整返回false
+bool decodeChunkedBody(const QByteArray& raw, QByteArray *body)
+{
+    body->clear();
+    int pos = 0;
+    for (;;) {
+        const int lineEnd = raw.indexOf("\r\n", pos);
+        if (lineEnd < 0) return false;
+        bool ok = false;
+        const int size = raw.mid(pos, lineEnd - pos).split(';').first().trimmed().toInt(&ok, 16);
+        if (!ok) return false;
+        pos = lineEnd + 2;
+        if (size == 0) return true;
+        if (raw.size() < pos + size + 2) return false;
+        body->append(raw.constData() + pos, size);
+        pos += size + 2;
+    }
+}
+}
+
+ChunkedFormUpload::ChunkedFormUpload(const QUrl& url, QObject *parent)
+    : QObject(parent)
+    , url(url)
+    , socket(new QTcpSocket(this))
+    , responseTimer(new QTimer(this))
+    , boundary("----FaceVoice" + QUuid::createUuid().toByteArray(QUuid::Id128))
+    , state(Idle)
+    , bodyQueued(false)
+    , bodySent(false)
+{
+    responseTimer->setSingleShot(true);
+    connect(responseTimer, &QTimer::timeout, this, [this]() { fail(QStringLiteral("等待服务器响应超时")); });
+    connect(socket, &QTcpSocket::readyRead, this, &ChunkedFormUpload::onReadyRead);
+    connect(socket, &QTcpSocket::disconnected, this, &ChunkedFormUpload::onDisconnected);
+    connect(socket, &QTcpSocket::bytesWritten, this, [this]() {
+        if (bodyQueued && socket->bytesToWrite() == 0) {
+            bodySent = true;
+        }
+    });
+    auto onSocketError = [this]() {
+        // 服务端发送完响应后关闭连接属正常结束，由onDisconnected处理
+        if (socket->error() != QAbstractSocket::RemoteHostClosedError) {
+            fail(socket->errorString());
+        }
+    };
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(socket, &QTcpSocket::errorOccurred, this, onSocketError);
+#else
+    connect(socket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error), this, onSocketError);
+#endif
+}
+
+ChunkedFormUpload::~ChunkedFormUpload()
+{
+    if (state == Streaming || state == AwaitingResponse) {
+        socket->abort();
+    }
+}
+
+QByteArray ChunkedFormUpload::fieldPart(const QString& name, const QString& value) const
+{
+    return "--" + boundary + "\r\n"
+           "Content-Disposition: form-data; name=\"" + name.toUtf8() + "\"\r\n\r\n"
+           + value.toUtf8() + "\r\n";
+}
+
+bool ChunkedFormUpload::start(const FormFields& fields, const QString& fileField, const QString& fileName,
+                              const QByteArray& fileContentType, const QByteArray& fileHead)
+{
+    if (state != Idle || url.scheme() != QLatin1String("http")) {
+        return false;
+    }
+    QByteArray path = url.path(QUrl::FullyEncoded).toUtf8();
+    if (path.isEmpty()) path = "/";
+    if (url.hasQuery()) path += "?" + url.query(QUrl::FullyEncoded).toUtf8();
+    const QByteArray host = url.host().toUtf8() + (url.port() > 0 ? ":" + QByteArray::number(url.port()) : QByteArray());
+
+    // 写入在连接建立前由QTcpSocket缓冲，连接后依次发出
+    socket->connectToHost(url.host(), quint16(url.port(80)));
+    socket->write("POST " + path + " HTTP/1.1\r\n"
+                  "Host: " + host + "\r\n"
+                  "Content-Type: multipart/form-data; boundary=" + boundary + "\r\n"
+                  "Transfer-Encoding: chunked\r\n"
+                  "Connection: close\r\n\r\n");
+    state = Streaming;
+
+    QByteArray head;
+    for (const auto& field : fields) {
+        head += fieldPart(field.first, field.second);
+    }
+    head += "--" + boundary + "\r\n"
+            "Content-Disposition: form-data; name=\"" + fileField.toUtf8() + "\"; filename=\"" + fileName.toUtf8() + "\"\r\n"
+            "Content-Type: " + fileContentType + "\r\n\r\n";
+    head += fileHead;
+    writeChunk(head);
+    return true;
+}
+
+void ChunkedFormUpload::appendFileData(const QByteArray& data)
+{
+    if (state == Streaming && !data.isEmpty()) {
+        writeChunk(data);
+    }
+}
+
+void ChunkedFormUpload::finish(const FormFields& trailingFields)
+{
+    if (state != Streaming) {
+        return;
+    }
+    QByteArray tail = "\r\n";
+    for (const auto& field : trailingFields) {
+        tail += fieldPart(field.first, field.second);
+    }
+    tail += "--" + boundary + "--\r\n";
+    writeChunk(tail);
+    socket->write("0\r\n\r\n");
+    state = AwaitingResponse;
+    bodyQueued = true;
+    responseTimer->start(kResponseTimeoutMs);
+}
+
+void ChunkedFormUpload::abort()
+{
+    if (state == Streaming || state == AwaitingResponse) {
+        state = Done;
+        responseTimer->stop();
+        socket->abort();
+    }
+}
+
+void ChunkedFormUpload::writeChunk(const QByteArray& data)
+{
+    socket->write(QByteArray::number(data.size(), 16) + "\r\n" + data + "\r\n");
+}
+
+void ChunkedFormUpload::onReadyRead()
+{
+    response.append(socket->readAll());
+    if (state == AwaitingResponse) {
+        tryCompleteResponse(false);
+    } else if (state == Streaming && response.contains("\r\n\r\n")) {
+        // 请求体未发完服务端就已响应（通常是拒绝），按结果结束
+        state = AwaitingResponse;
+        tryCompleteResponse(false);
+    }
+}
+
+void ChunkedFormUpload::onDisconnected()
+{
+    response.append(socket->readAll());
+    if (state == AwaitingResponse) {
+        if (!tryCompleteResponse(true)) {
+            fail(QStringLiteral("服务器响应不完整"));
+        }
+    } else if (state == Streaming) {
+        fail(QStringLiteral("上传连接被服务器关闭"));
+    }
+}
+
+bool ChunkedFormUpload::tryCompleteResponse(bool connectionClosed)
+{
+    const int headerEnd = response.indexOf("\r\n\r\n");
+    if (headerEnd < 0) {
+        return false;
+    }
+    const QList<QByteArray> lines = response.left(headerEnd).split('\n');
+    // 状态行：HTTP/1.1 200 OK
+    const QList<QByteArray> statusParts = lines.first().trimmed().split(' ');
+    const int status = statusParts.size() >= 2 ? statusParts.at(1).toInt() : 0;
+    if (status == 100) {
+        // 100 Continue：丢弃临时响应，继续等待最终响应
+        response.remove(0, headerEnd + 4);
+        return tryCompleteResponse(connectionClosed);
+    }
+
+    qint64 contentLength = -1;
+    bool chunked = false;
+    for (int i = 1; i < lines.size(); ++i) {
+        const QByteArray line = lines.at(i).trimmed();
+        const int colon = line.indexOf(':');
+        if (colon < 0) continue;
+        const QByteArray name = line.left(colon).trimmed().toLower();
+        const QByteArray value = line.mid(colon + 1).trimmed();
+        if (name == "content-length") {
+            contentLength = value.toLongLong();
+        } else if (name == "transfer-encoding" && value.toLower().contains("chunked")) {
+            chunked = true;
+        }
+    }
+
+    const QByteArray raw = response.mid(headerEnd + 4);
+    QByteArray body;
+    if (chunked) {
+        if (!decodeChunkedBody(raw, &body)) return false;
+    } else if (contentLength >= 0) {
+        if (raw.size() < contentLength) return false;
+        body = raw.left(int(contentLength));
+    } else if (connectionClosed) {
+        body = raw;
+    } else {
+        return false;
+    }
+
+    state = Done;
+    responseTimer->stop();
+    socket->abort();
+    emit finished(status, body);
+    return true;
+}
+
+void ChunkedFormUpload::fail(const QString& error)
+{
+    if (state == Done) {
+        return;
+    }
+    state = Done;
+    responseTimer->stop();
+    socket->abort();
+    qDebug() << "分块上传失败:" << error;
+    emit failed(error);
+}
@@ -0,0 +1,62 @@
+#ifndef CHUNKEDFORMUPLOAD_H
+#define CHUNKEDFORMUPLOAD_H
+
+#include <QObject>
+#include <QUrl>
+#include <QList>
+#include <QPair>
+#include <QByteArray>
+
+class QTcpSocket;
+class QTimer;
+
+// 边录边传：以 HTTP/1.1 chunked 编码发送 multipart/form-data 请求，文件分段的数据可在请求发出后陆续追加。
+// QNetworkAccessManager 不支持分块上传（长度未知的请求体会被整体缓冲），故直接基于 QTcpSocket 实现，仅支持 http。
+class ChunkedFormUpload : public QObject
+{
+    Q_OBJECT
+public:
+    typedef QList<QPair<QString, QString>> FormFields;
+
+    explicit ChunkedFormUpload(const QUrl& url, QObject *parent = nullptr);
+    ~ChunkedFormUpload() override;
+
+    // 建立连接并发送请求头、fields 以及文件分段头（fileHead 为文件开头字节，如WAV头）
+    bool start(const FormFields& fields, const QString& fileField, const QString& fileName,
+               const QByteArray& fileContentType, const QByteArray& fileHead);
+    void appendFileData(const QByteArray& data);
+    // 结束文件分段，发送其余字段并结束请求体，然后等待响应
+    void finish(const FormFields& trailingFields);
+    void abort();
+
+    // 请求体尚未结束且未出错，可以继续追加/结束
+    bool isOpen() const { return state == Streaming; }
+    // 请求体已完整写入连接；此后失败时服务端可能已处理该请求，未完整写入时服务端不会处理
+    bool bodyComplete() const { return bodySent; }
+
+signals:
+    void finished(int httpStatus, const QByteArray& body);
+    void failed(const QString& error);
+
+private:
+    enum State { Idle, Streaming, AwaitingResponse, Done };
+
+    void writeChunk(const QByteArray& data);
+    void onReadyRead();
+    void onDisconnected();
+    // 响应完整时解析出状态码与正文
+    bool tryCompleteResponse(bool connectionClosed);
+    void fail(const QString& error);
+    QByteArray fieldPart(const QString& name, const QString& value) const;
+
+    QUrl url;
+    QTcpSocket *socket;
+    QTimer *responseTimer;
+    QByteArray boundary;
+    QByteArray response;
+    State state;
+    bool bodyQueued; // finish已调用，结束块已进入发送缓冲
+    bool bodySent;
+};
+
+#endif // CHUNKEDFORMUPLOAD_H
@@ -0,0 +1,145 @@
+#include "faceassetloader.h"
+#include "faceatlas.h"
+#include <QtConcurrent>
+#include <QPainter>
+#include <QDebug>
+
+namespace {
+// 工作线程中执行：缩放、压平并转换为绘制友好的预乘格式，GUI线程转QPixmap时无需再转换
+QImage prepareFaceImage(QImage img, const QSize& targetSize, const QColor& background)
+{
+    if (targetSize.isValid() && img.size() != targetSize) {
+        img = img.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    if (background.isValid() && img.hasAlphaChannel()) {
+        QImage opaque(img.size(), QImage::Format_RGB32);
+        opaque.fill(background);
+        QPainter p(&opaque);
+        p.drawImage(0, 0, img);
+        p.end();
+        img = opaque;
+    } else if (img.format() != QImage::Format_ARGB32_Premultiplied && img.format() != QImage::Format_RGB32) {
+        img = img.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+    return img;
+}
+
+QPair<QString, QImage> decodeFaceAsset(const FaceAssetRequest& request)
+{
+    const QImage img(request.path);
+    if (img.isNull()) {
+        return qMakePair(request.key, img);
+    }
+    return qMakePair(request.key, prepareFaceImage(img, request.targetSize, request.background));
+}
+
+// 工作线程中执行：映射图集并逐帧缩放。帧在映射内存上直接读取，未缩放/压平的帧需拷贝出来，图集随即关闭
+QList<QPair<QString, QImage>> loadFaceAtlas(const QString& path, const QSize& targetSize, const QColor& background)
+{
+    QList<QPair<QString, QImage>> results;
+    FaceAtlas atlas;
+    if (!atlas.open(path)) {
+        return results;
+    }
+    for (int i = 0; i < atlas.frameCount(); ++i) {
+        const QImage mappedFrame = atlas.frame(i);
+        QImage img = prepareFaceImage(mappedFrame, targetSize, background);
+        if (img.constBits() == mappedFrame.constBits()) {
+            img = img.copy();
+        }
+        results.append(qMakePair(FaceAssetLoader::atlasFrameKey(i), img));
+    }
+    return results;
+}
+}
+
+QString FaceAssetLoader::atlasFrameKey(int index)
+{
+    return QString("frame_%1").arg(index, 4, 10, QLatin1Char('0'));
+}
+
+FaceAssetLoader::FaceAssetLoader(QObject *parent)
+    : QObject(parent)
+    , watcher(new QFutureWatcher<QPair<QString, QImage>>(this))
+    , atlasWatcher(new QFutureWatcher<QList<QPair<QString, QImage>>>(this))
+    , ready(false)
+{
+    connect(watcher, &QFutureWatcherBase::finished, this, &FaceAssetLoader::onDecodeFinished);
+    connect(atlasWatcher, &QFutureWatcherBase::finished, this, &FaceAssetLoader::onAtlasFinished);
+}
+
+FaceAssetLoader::~FaceAssetLoader()
+{
+    // 析构前等待工作线程结束，避免回调访问已释放对象
+    watcher->cancel();
+    watcher->waitForFinished();
+    atlasWatcher->waitForFinished();
+}
+
+void FaceAssetLoader::reset(const QSize& targetSize)
+{
+    if (watcher->isRunning()) {
+        watcher->cancel();
+        watcher->waitForFinished();
+    }
+    if (atlasWatcher->isRunning()) {
+        atlasWatcher->cancel();
+        atlasWatcher->waitForFinished();
+    }
+    ready = false;
+    images.clear();
+    scaledSize = targetSize;
+}
+
+void FaceAssetLoader::loadAtlas(const QString& path, const QSize& targetSize, const QColor& background)
+{
+    reset(targetSize);
+    atlasWatcher->setFuture(QtConcurrent::run(loadFaceAtlas, path, targetSize, background));
+}
+
+void FaceAssetLoader::load(const QHash<QString, QString>& files, const QSize& targetSize, const QColor& background)
+{
+    reset(targetSize);
+
+    QList<FaceAssetRequest> entries;
+    for (auto it = files.cbegin(); it != files.cend(); ++it) {
+        FaceAssetRequest request;
+        request.key = it.key();
+        request.path = it.value();
+        request.targetSize = targetSize;
+        request.background = background;
+        entries.append(request);
+    }
+    watcher->setFuture(QtConcurrent::mapped(entries, decodeFaceAsset));
+}
+
+void FaceAssetLoader::onDecodeFinished()
+{
+    if (watcher->isCanceled()) {
+        return;
+    }
+    const QList<QPair<QString, QImage>> results = watcher->future().results();
+    for (const auto& result : results) {
+        if (result.second.isNull()) {
+            qDebug() << "[资源加载] 解码失败:" << result.first;
+            continue;
+        }
+        images.insert(result.first, result.second);
+    }
+    ready = true;
+    qDebug() << "[资源加载] 完成，共" << images.size() << "张";
+    emit assetsReady();
+}
+
+void FaceAssetLoader::onAtlasFinished()
+{
+    if (atlasWatcher->isCanceled()) {
+        return;
+    }
+    for (const auto& result : atlasWatcher->result()) {
+        images.insert(result.first, result.second);
+    }
+    ready = true;
+    qDebug() << "[资源加载] 图集完成，共" << images.size() << "帧";
+    emit assetsReady();
+}
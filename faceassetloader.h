@@ -0,0 +1,60 @@
+#ifndef FACEASSETLOADER_H
+#define FACEASSETLOADER_H
+
+#include <QObject>
+#include <QHash>
+#include <QImage>
+#include <QPair>
+#include <QString>
+#include <QSize>
+#include <QColor>
+#include <QFutureWatcher>
+#include <QList>
+#include <QStringList>
+
+// 单个资源的解码请求；targetSize有效时在工作线程内预缩放，background有效时压平透明通道
+struct FaceAssetRequest {
+    QString key;
+    QString path;
+    QSize targetSize;
+    QColor background;
+};
+
+// 表情资源异步加载器：在线程池中解码PNG（或映射.fatlas图集）为QImage，完成后在GUI线程发出assetsReady()
+class FaceAssetLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FaceAssetLoader(QObject *parent = nullptr);
+    ~FaceAssetLoader();
+
+    // key 为资源名（如 "normal.png"），value 为实际路径
+    void load(const QHash<QString, QString>& files,
+              const QSize& targetSize = QSize(), const QColor& background = QColor());
+    // 图集的全部帧，键为 atlasFrameKey(i)；打开失败时 assetsReady() 后 keys() 为空
+    void loadAtlas(const QString& path, const QSize& targetSize = QSize(), const QColor& background = QColor());
+    static QString atlasFrameKey(int index);
+
+    bool isReady() const { return ready; }
+    QSize targetSize() const { return scaledSize; }
+    QImage image(const QString& key) const { return images.value(key); }
+    QStringList keys() const { return images.keys(); }
+
+signals:
+    void assetsReady();
+
+private slots:
+    void onDecodeFinished();
+    void onAtlasFinished();
+
+private:
+    void reset(const QSize& targetSize);
+
+    QFutureWatcher<QPair<QString, QImage>> *watcher;
+    QFutureWatcher<QList<QPair<QString, QImage>>> *atlasWatcher;
+    QHash<QString, QImage> images;
+    QSize scaledSize;
+    bool ready;
+};
+
+#endif // FACEASSETLOADER_H
@@ -0,0 +1,196 @@
+#include "faceatlas.h"
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+const char kMagic[4] = { 'F', 'A', 'T', 'L' };
+const int kHeaderSize = 32;
+const int kIndexEntrySize = 16;
+const quint64 kFrameAlignment = 16;
+
+// 单边像素上限，防止损坏的头部引发溢出
+const quint32 kMaxDimension = 16384;
+
+quint64 alignUp(quint64 value)
+{
+    return (value + kFrameAlignment - 1) & ~(kFrameAlignment - 1);
+}
+
+// 图集只存放32位像素，帧按原样映射为QImage
+bool isSupportedFormat(quint32 format)
+{
+    return format == quint32(QImage::Format_RGB32)
+        || format == quint32(QImage::Format_ARGB32)
+        || format == quint32(QImage::Format_ARGB32_Premultiplied);
+}
+}
+
+FaceAtlas::FaceAtlas()
+    : mapped(nullptr)
+    , mappedSize(0)
+    , width(0)
+    , height(0)
+    , bytesPerLine(0)
+    , format(QImage::Format_Invalid)
+{
+}
+
+FaceAtlas::~FaceAtlas()
+{
+    close();
+}
+
+bool FaceAtlas::open(const QString& path)
+{
+    close();
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    mappedSize = file.size();
+    if (mappedSize < kHeaderSize) {
+        qDebug() << "[图集] 文件过小:" << path;
+        close();
+        return false;
+    }
+    mapped = file.map(0, mappedSize);
+    if (!mapped) {
+        qDebug() << "[图集] 映射失败:" << path << file.errorString();
+        close();
+        return false;
+    }
+
+    if (std::memcmp(mapped, kMagic, 4) != 0
+        || qFromLittleEndian<quint32>(mapped + 4) != Version
+        || qFromLittleEndian<quint32>(mapped + 28) != NoCompression) {
+        qDebug() << "[图集] 格式不支持:" << path;
+        close();
+        return false;
+    }
+    const quint32 count = qFromLittleEndian<quint32>(mapped + 8);
+    const quint32 rawWidth = qFromLittleEndian<quint32>(mapped + 12);
+    const quint32 rawHeight = qFromLittleEndian<quint32>(mapped + 16);
+    const quint32 rawBytesPerLine = qFromLittleEndian<quint32>(mapped + 20);
+    const quint32 rawFormat = qFromLittleEndian<quint32>(mapped + 24);
+    // 头部决定QImage如何访问映射内存，任何不一致都会越界读，必须整体拒绝
+    if (rawWidth == 0 || rawHeight == 0 || rawWidth > kMaxDimension || rawHeight > kMaxDimension
+        || !isSupportedFormat(rawFormat)
+        || quint64(rawBytesPerLine) < quint64(rawWidth) * 4 || rawBytesPerLine % 4 != 0
+        || rawBytesPerLine > kMaxDimension * 4) {
+        qDebug() << "[图集] 头部无效:" << path << rawWidth << rawHeight << rawBytesPerLine << rawFormat;
+        close();
+        return false;
+    }
+    width = int(rawWidth);
+    height = int(rawHeight);
+    bytesPerLine = int(rawBytesPerLine);
+    format = QImage::Format(rawFormat);
+
+    const quint64 frameBytes = quint64(bytesPerLine) * quint64(height);
+    if (quint64(kHeaderSize) + quint64(count) * kIndexEntrySize > quint64(mappedSize)) {
+        qDebug() << "[图集] 索引越界:" << path;
+        close();
+        return false;
+    }
+    const uchar *index = mapped + kHeaderSize;
+    for (quint32 i = 0; i < count; ++i) {
+        FrameEntry entry;
+        entry.offset = qFromLittleEndian<quint64>(index + i * kIndexEntrySize);
+        entry.length = qFromLittleEndian<quint64>(index + i * kIndexEntrySize + 8);
+        if (entry.length < frameBytes || entry.offset % 4 != 0
+            || entry.offset > quint64(mappedSize) || entry.length > quint64(mappedSize) - entry.offset) {
+            qDebug() << "[图集] 帧数据越界:" << path << i;
+            close();
+            return false;
+        }
+        frames.append(entry);
+    }
+    return true;
+}
+
+void FaceAtlas::close()
+{
+    if (mapped) {
+        file.unmap(mapped);
+        mapped = nullptr;
+    }
+    if (file.isOpen()) {
+        file.close();
+    }
+    mappedSize = 0;
+    frames.clear();
+}
+
+QImage FaceAtlas::frame(int index) const
+{
+    if (!mapped || index < 0 || index >= frames.size()) {
+        return QImage();
+    }
+    // const uchar* 构造的QImage只读共享外部内存，不拷贝
+    const uchar *bits = mapped + frames.at(index).offset;
+    return QImage(bits, width, height, bytesPerLine, format);
+}
+
+bool FaceAtlas::write(const QString& path, const QList<QImage>& images, QImage::Format format, QString *errorString)
+{
+    auto fail = [errorString](const QString& message) {
+        if (errorString) *errorString = message;
+        return false;
+    };
+    if (images.isEmpty()) {
+        return fail(QStringLiteral("no frames"));
+    }
+    if (!isSupportedFormat(quint32(format))) {
+        return fail(QStringLiteral("unsupported pixel format"));
+    }
+    const QSize size = images.first().size();
+    QList<QImage> converted;
+    for (const QImage& img : images) {
+        if (img.size() != size) {
+            return fail(QStringLiteral("frame size mismatch"));
+        }
+        converted.append(img.convertToFormat(format));
+    }
+    const int bpl = converted.first().bytesPerLine();
+    const quint64 frameBytes = quint64(bpl) * quint64(size.height());
+
+    QFile out(path);
+    if (!out.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return fail(out.errorString());
+    }
+
+    QByteArray header(kHeaderSize, '\0');
+    uchar *h = reinterpret_cast<uchar*>(header.data());
+    std::memcpy(h, kMagic, 4);
+    qToLittleEndian<quint32>(Version, h + 4);
+    qToLittleEndian<quint32>(quint32(converted.size()), h + 8);
+    qToLittleEndian<quint32>(quint32(size.width()), h + 12);
+    qToLittleEndian<quint32>(quint32(size.height()), h + 16);
+    qToLittleEndian<quint32>(quint32(bpl), h + 20);
+    qToLittleEndian<quint32>(quint32(format), h + 24);
+    qToLittleEndian<quint32>(quint32(NoCompression), h + 28);
+
+    QByteArray index(converted.size() * kIndexEntrySize, '\0');
+    quint64 offset = alignUp(quint64(kHeaderSize) + quint64(index.size()));
+    for (int i = 0; i < converted.size(); ++i) {
+        uchar *e = reinterpret_cast<uchar*>(index.data()) + i * kIndexEntrySize;
+        qToLittleEndian<quint64>(offset, e);
+        qToLittleEndian<quint64>(frameBytes, e + 8);
+        offset = alignUp(offset + frameBytes);
+    }
+
+    out.write(header);
+    out.write(index);
+    for (const QImage& img : converted) {
+        const qint64 padding = qint64(alignUp(quint64(out.pos())) - quint64(out.pos()));
+        if (padding > 0) {
+            out.write(QByteArray(int(padding), '\0'));
+        }
+        out.write(reinterpret_cast<const char*>(img.constBits()), qint64(frameBytes));
+    }
+    if (!out.flush()) {
+        return fail(out.errorString());
+    }
+    return true;
+}
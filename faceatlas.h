@@ -0,0 +1,55 @@
+#ifndef FACEATLAS_H
+#define FACEATLAS_H
+
+#include <QFile>
+#include <QImage>
+#include <QList>
+#include <QString>
+
+// 表情帧图集（.fatlas）：未压缩像素 + 帧索引，整体通过QFile::map映射，
+// 取帧只是在映射内存上构造QImage，不做任何解码。
+//
+// 文件布局（小端）：
+//   头部 32 字节：magic "FATL" | version | frameCount | width | height | bytesPerLine | format | compression
+//   索引 frameCount * 16 字节：每帧 quint64 offset, quint64 length
+//   帧数据：每帧起始按16字节对齐
+class FaceAtlas
+{
+public:
+    static const quint32 Version = 1;
+    // 预留压缩字段，目前仅支持不压缩（直接映射访问）
+    enum Compression : quint32 { NoCompression = 0 };
+
+    FaceAtlas();
+    ~FaceAtlas();
+
+    bool open(const QString& path);
+    void close();
+    bool isOpen() const { return mapped != nullptr; }
+
+    int frameCount() const { return frames.size(); }
+    QSize frameSize() const { return QSize(width, height); }
+    // 返回直接引用映射内存的只读QImage；图集关闭后失效
+    QImage frame(int index) const;
+
+    // 离线打包：全部帧须同尺寸，统一转换为format（RGB32/ARGB32/ARGB32_Premultiplied）后写出
+    static bool write(const QString& path, const QList<QImage>& images,
+                      QImage::Format format = QImage::Format_RGB32, QString *errorString = nullptr);
+
+private:
+    struct FrameEntry {
+        quint64 offset;
+        quint64 length;
+    };
+
+    QFile file;
+    uchar *mapped;
+    qint64 mappedSize;
+    QList<FrameEntry> frames;
+    int width;
+    int height;
+    int bytesPerLine;
+    QImage::Format format;
+};
+
+#endif // FACEATLAS_H
@@ -0,0 +1,210 @@
+#include "facecanvas.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QResizeEvent>
+#include <QImage>
+#include <QtConcurrent>
+#include <cstring>
+
+QRect FaceCanvas::diffRect(const QImage& from, const QImage& to)
+{
+    if (from.size() != to.size()) {
+        return QRect(QPoint(0, 0), to.size());
+    }
+    const QImage a = from.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const QImage b = to.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    const int w = a.width();
+    const int h = a.height();
+    const size_t rowBytes = size_t(w) * 4;
+
+    int top = 0;
+    while (top < h && std::memcmp(a.constScanLine(top), b.constScanLine(top), rowBytes) == 0) {
+        ++top;
+    }
+    if (top == h) {
+        return QRect();
+    }
+    int bottom = h - 1;
+    while (bottom > top && std::memcmp(a.constScanLine(bottom), b.constScanLine(bottom), rowBytes) == 0) {
+        --bottom;
+    }
+
+    int left = w;
+    int right = -1;
+    for (int y = top; y <= bottom; ++y) {
+        const quint32 *ra = reinterpret_cast<const quint32*>(a.constScanLine(y));
+        const quint32 *rb = reinterpret_cast<const quint32*>(b.constScanLine(y));
+        for (int x = 0; x < left; ++x) {
+            if (ra[x] != rb[x]) { left = x; break; }
+        }
+        for (int x = w - 1; x > right; --x) {
+            if (ra[x] != rb[x]) { right = x; break; }
+        }
+    }
+    if (right < left) {
+        return QRect();
+    }
+    return QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+FaceCanvas::FaceCanvas(QWidget *parent)
+    : QWidget(parent)
+    , fadeProgress(1.0)
+    , fading(false)
+    , dirtyRectGeneration(0)
+{
+    // 每次绘制都覆盖整个脏区域，无需Qt预先擦除背景
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setAttribute(Qt::WA_NoSystemBackground);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+}
+
+void FaceCanvas::setFrame(const QPixmap& frame)
+{
+    if (fading) {
+        // 结束交叉淡化：混合过的区域需要按新帧重绘
+        fading = false;
+        updateBetween(fadeFrom, current);
+        fadeFrom = QPixmap();
+    }
+    if (frame.cacheKey() == current.cacheKey()) {
+        return;
+    }
+    const QPixmap previous = current;
+    current = frame;
+    updateBetween(previous, frame);
+}
+
+void FaceCanvas::setCrossFade(const QPixmap& from, const QPixmap& to, qreal progress)
+{
+    if (from.isNull() || to.isNull() || from.size() != to.size()) {
+        setFrame(to);
+        return;
+    }
+    fadeFrom = from;
+    current = to;
+    fadeProgress = qBound<qreal>(0.0, progress, 1.0);
+    fading = true;
+    // 只有两帧不同的区域会随进度变化
+    updateBetween(from, to);
+}
+
+void FaceCanvas::precomputeDirtyRects(const QList<QPair<QPixmap, QPixmap>>& pairs)
+{
+    // QtConcurrent::run 无法取消，不等待上一次计算，按代数丢弃其结果
+    const int generation = ++dirtyRectGeneration;
+    dirtyRects.clear();
+
+    // GUI线程只取出像素（光栅后端下为浅拷贝），格式转换与比较都在工作线程
+    QHash<qint64, QImage> images;
+    QList<FramePair> keys;
+    for (const auto& pair : pairs) {
+        if (pair.first.isNull() || pair.second.isNull() || pair.first.size() != pair.second.size()) {
+            continue;
+        }
+        for (const QPixmap *pix : { &pair.first, &pair.second }) {
+            if (!images.contains(pix->cacheKey())) {
+                images.insert(pix->cacheKey(), pix->toImage());
+            }
+        }
+        keys.append(FramePair(pair.first.cacheKey(), pair.second.cacheKey()));
+    }
+    if (keys.isEmpty()) {
+        return;
+    }
+    QFutureWatcher<DirtyRectTable> *watcher = new QFutureWatcher<DirtyRectTable>(this);
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, watcher, generation]() {
+        watcher->deleteLater();
+        if (generation == dirtyRectGeneration) {
+            dirtyRects = watcher->result();
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([images, keys]() {
+        DirtyRectTable table;
+        for (const FramePair& key : keys) {
+            const QRect rect = diffRect(images.value(key.first), images.value(key.second));
+            // 差异区域对称，反向切换共用
+            table.insert(key, rect);
+            table.insert(FramePair(key.second, key.first), rect);
+        }
+        return table;
+    }));
+}
+
+
+bool FaceCanvas::knownDirtyRect(const QPixmap& from, const QPixmap& to, QRect *dirty) const
+{
+    auto it = dirtyRects.constFind(FramePair(from.cacheKey(), to.cacheKey()));
+    if (it == dirtyRects.constEnd()) {
+        return false;
+    }
+    *dirty = it.value();
+    return true;
+}
+
+void FaceCanvas::updateBetween(const QPixmap& from, const QPixmap& to)
+{
+    QRect dirty;
+    if (from.isNull() || to.isNull() || from.size() != to.size() || !knownDirtyRect(from, to, &dirty)) {
+        update();
+    } else if (!dirty.isEmpty()) {
+        update(frameToWidget(dirty));
+    }
+}
+
+QRect FaceCanvas::frameToWidget(const QRect& frameRect) const
+{
+    // 帧像素坐标 -> 控件坐标（考虑devicePixelRatio及尺寸不符时的拉伸），外扩1像素抵消取整误差
+    const QSizeF frameSize = current.size();
+    if (frameSize.isEmpty()) {
+        return rect();
+    }
+    const qreal sx = width() / frameSize.width();
+    const qreal sy = height() / frameSize.height();
+    const QRectF mapped(frameRect.x() * sx, frameRect.y() * sy,
+                        frameRect.width() * sx, frameRect.height() * sy);
+    return mapped.toAlignedRect().adjusted(-1, -1, 1, 1) & rect();
+}
+
+void FaceCanvas::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    const QRect dirty = event->rect();
+    // 与原QLabel透明背景时的观感一致：透出窗口底色
+    if (current.isNull() || current.hasAlphaChannel()) {
+        painter.fillRect(dirty, palette().color(QPalette::Window));
+    }
+    if (current.isNull()) {
+        return;
+    }
+
+    if (fading) {
+        // 预缩放的不透明帧上做常量alpha混合，走光栅引擎的SIMD混合路径
+        drawFrame(painter, fadeFrom, dirty);
+        painter.setOpacity(fadeProgress);
+    }
+    drawFrame(painter, current, dirty);
+}
+
+void FaceCanvas::drawFrame(QPainter& painter, const QPixmap& frame, const QRect& dirty)
+{
+    const QSize deviceSize = size() * devicePixelRatioF();
+    if (frame.size() == deviceSize) {
+        // 预缩放帧：按脏区域直接拷贝，无缩放
+        const qreal dpr = devicePixelRatioF();
+        const QRectF source(dirty.x() * dpr, dirty.y() * dpr, dirty.width() * dpr, dirty.height() * dpr);
+        painter.drawPixmap(QRectF(dirty), frame, source);
+    } else {
+        // 尺寸未匹配（如占位脸或缓存重建前），退化为整体拉伸
+        painter.drawPixmap(rect(), frame);
+    }
+}
+
+void FaceCanvas::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    // 旧尺寸帧的差异区域不再适用，进行中的计算结果也作废，等帧缓存重建后重新计算
+    ++dirtyRectGeneration;
+    dirtyRects.clear();
+    emit canvasResized(event->size());
+}
@@ -0,0 +1,59 @@
+#ifndef FACECANVAS_H
+#define FACECANVAS_H
+
+#include <QWidget>
+#include <QPixmap>
+#include <QHash>
+#include <QPair>
+#include <QList>
+#include <QImage>
+#include <QFutureWatcher>
+
+// 表情画布：直接绘制预缩放帧，替代QLabel::setScaledContents。
+// 眨眼、searching、表情淡化等固定帧对的差异区域在帧缓存重建时由 precomputeDirtyRects() 在工作线程算好，
+// 切换这些帧对时只重绘差异区域；其余帧对（插值序列等）直接整体重绘，绘制线程上不做逐像素比较
+class FaceCanvas : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit FaceCanvas(QWidget *parent = nullptr);
+
+    // frame应为按画布尺寸预缩放的帧；尺寸不符时退化为绘制时缩放
+    void setFrame(const QPixmap& frame);
+    QPixmap frame() const { return current; }
+    // 交叉淡化：按progress(0~1)在绘制时混合from与to，调用setFrame()即结束
+    void setCrossFade(const QPixmap& from, const QPixmap& to, qreal progress);
+    // 后台计算给定帧对的差异区域，替换之前的结果；计算完成前按整体重绘处理
+    void precomputeDirtyRects(const QList<QPair<QPixmap, QPixmap>>& pairs);
+
+    // 两帧差异的包围矩形（帧像素坐标）；尺寸或格式不同返回整帧。可在任意线程调用
+    static QRect diffRect(const QImage& from, const QImage& to);
+
+signals:
+    void canvasResized(const QSize& size);
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    typedef QPair<qint64, qint64> FramePair;
+    typedef QHash<FramePair, QRect> DirtyRectTable;
+
+    // 未知帧对返回false
+    bool knownDirtyRect(const QPixmap& from, const QPixmap& to, QRect *dirty) const;
+    void updateBetween(const QPixmap& from, const QPixmap& to);
+    QRect frameToWidget(const QRect& frameRect) const;
+    void drawFrame(QPainter& painter, const QPixmap& frame, const QRect& dirty);
+
+    QPixmap current;
+    QPixmap fadeFrom;
+    qreal fadeProgress;
+    bool fading;
+    // 帧对(cacheKey) -> 差异区域（帧像素坐标），只含 precomputeDirtyRects() 给出的帧对
+    DirtyRectTable dirtyRects;
+    // 每次计算/尺寸变化递增；完成时代数不符的结果已过期，直接丢弃
+    int dirtyRectGeneration;
+};
+
+#endif // FACECANVAS_H
@@ -3,7 +3,7 @@ QT       += core gui
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
 # 添加动画模块、网络模块和多媒体模块支持
-QT += widgets core gui network multimedia
+QT += widgets core gui network multimedia concurrent
 
 CONFIG += c++11
 
@@ -22,16 +22,55 @@ SOURCES += \
     main.cpp \
     widget.cpp \
     interfacewidget.cpp \
-    registrationwidget.cpp
+    registrationwidget.cpp \
+    faceassetloader.cpp \
+    facecanvas.cpp \
+    frametimeline.cpp \
+    faceatlas.cpp \
+    socketserverworker.cpp \
+    overlaytextview.cpp \
+    nerstreamparser.cpp \
+    nersessionmanager.cpp \
+    voicecapture.cpp \
+    voiceactivitydetector.cpp \
+    chunkedformupload.cpp \
+    llmingestqueue.cpp
 
 HEADERS += \
     widget.h \
     interfacewidget.h \
-    registrationwidget.h
+    registrationwidget.h \
+    faceassetloader.h \
+    facecanvas.h \
+    frametimeline.h \
+    faceatlas.h \
+    socketserverworker.h \
+    overlaytextview.h \
+    nerstreamparser.h \
+    nersessionmanager.h \
+    voicecapture.h \
+    voiceactivitydetector.h \
+    chunkedformupload.h \
+    llmingestqueue.h
 
 FORMS += \
     widget.ui
 
+# 表情资源：默认编译进程序（qt_face.qrc）；
+# CONFIG += face_external_rcc 时改为生成外部 qt_face.rcc，运行时内存映射加载
+# PNG本身已压缩，关闭rcc压缩以便直接从映射内存读取
+QMAKE_RESOURCE_FLAGS += -no-compress
+face_external_rcc {
+    DEFINES += FACE_EXTERNAL_RCC
+    faceRcc.target = qt_face.rcc
+    faceRcc.commands = $$shell_path($$[QT_HOST_BINS]/rcc) -binary -no-compress $$shell_path($$PWD/qt_face.qrc) -o $$shell_path($$OUT_PWD/qt_face.rcc)
+    faceRcc.depends = $$PWD/qt_face.qrc
+    QMAKE_EXTRA_TARGETS += faceRcc
+    PRE_TARGETDEPS += qt_face.rcc
+} else {
+    RESOURCES += qt_face.qrc
+}
+
 # Default rules for deployment.
 qnx: target.path = /tmp/$${TARGET}/bin
 else: unix:!android: target.path = /opt/$${TARGET}/bin
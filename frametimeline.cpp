@@ -0,0 +1,101 @@
+#include "frametimeline.h"
+
+FrameTimeline::FrameTimeline(QObject *parent)
+    : QObject(parent)
+    , timer(new QTimer(this))
+    , hasActive(false)
+    , frameIndex(0)
+{
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, &QTimer::timeout, this, &FrameTimeline::onTimeout);
+}
+
+void FrameTimeline::play(const QString& kind, const QList<TimelineFrame>& frames,
+                         const std::function<void()>& onFinished, Policy policy)
+{
+    if (policy == Policy::Coalesce) {
+        if (hasActive && active.kind == kind) {
+            active.onFinished = onFinished;
+            return;
+        }
+        for (Sequence& seq : pending) {
+            if (seq.kind == kind) {
+                seq.onFinished = onFinished;
+                return;
+            }
+        }
+    }
+
+    if (policy == Policy::Replace) {
+        timer->stop();
+        pending.clear();
+        hasActive = false;
+    }
+
+    Sequence seq;
+    seq.kind = kind;
+    seq.frames = frames;
+    seq.onFinished = onFinished;
+    pending.enqueue(seq);
+
+    if (!hasActive) {
+        startNext();
+    }
+}
+
+void FrameTimeline::cancel()
+{
+    timer->stop();
+    pending.clear();
+    hasActive = false;
+    active = Sequence();
+}
+
+void FrameTimeline::startNext()
+{
+    // 空序列直接完成；回调中可能再次调用play()，循环处理直至有帧可播或队列清空
+    while (!hasActive && !pending.isEmpty()) {
+        active = pending.dequeue();
+        if (!active.frames.isEmpty()) {
+            hasActive = true;
+            showFrame(0);
+            return;
+        }
+        const std::function<void()> done = active.onFinished;
+        active = Sequence();
+        if (done) done();
+    }
+}
+
+void FrameTimeline::showFrame(int index)
+{
+    frameIndex = index;
+    const TimelineFrame frame = active.frames.at(index);
+    timer->start(qMax(0, frame.durationMs));
+    if (frame.action) {
+        frame.action();
+    } else if (!frame.pixmap.isNull()) {
+        emit frameChanged(frame.pixmap);
+    }
+}
+
+void FrameTimeline::onTimeout()
+{
+    if (!hasActive) {
+        return;
+    }
+    if (frameIndex + 1 < active.frames.size()) {
+        showFrame(frameIndex + 1);
+        return;
+    }
+
+    // 先复位状态再执行回调，回调内发起的新序列可立即开始
+    const std::function<void()> done = active.onFinished;
+    active = Sequence();
+    hasActive = false;
+    if (done) done();
+    if (!hasActive) {
+        startNext();
+    }
+}
@@ -0,0 +1,68 @@
+#ifndef FRAMETIMELINE_H
+#define FRAMETIMELINE_H
+
+#include <QObject>
+#include <QPixmap>
+#include <QList>
+#include <QQueue>
+#include <QString>
+#include <QTimer>
+#include <functional>
+
+// 单帧：显示pixmap（或执行action实时渲染）并保持durationMs
+struct TimelineFrame {
+    QPixmap pixmap;
+    std::function<void()> action;
+    int durationMs;
+
+    TimelineFrame() : durationMs(0) {}
+    TimelineFrame(const QPixmap& pix, int ms) : pixmap(pix), durationMs(ms) {}
+    TimelineFrame(const std::function<void()>& fn, int ms) : action(fn), durationMs(ms) {}
+};
+
+// 帧时间线：用单个定时器顺序播放帧序列，每个序列结束后执行完成回调。
+// 新请求按策略处理，避免多个singleShot链交错出帧或触发过期回调。
+class FrameTimeline : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Policy {
+        Replace,  // 丢弃正在播放及排队的序列（不执行其回调），立即播放新序列
+        Coalesce, // 已有同类序列时仅以新回调替换其回调；否则排队
+        Queue     // 排在当前序列之后
+    };
+
+    explicit FrameTimeline(QObject *parent = nullptr);
+
+    void play(const QString& kind, const QList<TimelineFrame>& frames,
+              const std::function<void()>& onFinished, Policy policy);
+    // 丢弃全部序列，不执行回调
+    void cancel();
+
+    bool isBusy() const { return hasActive; }
+    QString activeKind() const { return hasActive ? active.kind : QString(); }
+
+signals:
+    void frameChanged(const QPixmap& frame);
+
+private slots:
+    void onTimeout();
+
+private:
+    struct Sequence {
+        QString kind;
+        QList<TimelineFrame> frames;
+        std::function<void()> onFinished;
+    };
+
+    void startNext();
+    void showFrame(int index);
+
+    QTimer *timer;
+    QQueue<Sequence> pending;
+    Sequence active;
+    bool hasActive;
+    int frameIndex;
+};
+
+#endif // FRAMETIMELINE_H
@@ -0,0 +1,150 @@
+#include "llmingestqueue.h"
+#include <QMutexLocker>
+#include <QDebug>
+
+LlmIngestQueue::LlmIngestQueue(QObject *parent)
+    : QObject(parent)
+    , queuedChars(0)
+    , consumerBacklog(0)
+    , highWatermark(8000)
+    , lowWatermark(2000)
+    , paused(false)
+    , notifyScheduled(false)
+{
+}
+
+void LlmIngestQueue::setWatermarks(int highChars, int lowChars)
+{
+    bool changed = false;
+    bool nowPaused = false;
+    {
+        QMutexLocker locker(&mutex);
+        highWatermark = qMax(1, highChars);
+        lowWatermark = qBound(0, lowChars, highWatermark);
+        changed = updatePausedLocked();
+        nowPaused = paused;
+    }
+    if (changed) emit backpressureChanged(nowPaused);
+}
+
+bool LlmIngestQueue::push(const QString& text, bool isFinal, Source source)
+{
+    bool notify = false;
+    bool changed = false;
+    bool nowPaused = false;
+    {
+        QMutexLocker locker(&mutex);
+        // 与同一来源的上一段合并，直到遇到结束标记
+        if (!segments.isEmpty() && !segments.last().isFinal && segments.last().source == source) {
+            segments.last().text.append(text);
+            segments.last().isFinal = isFinal;
+        } else {
+            segments.append(Segment{ text, isFinal, source });
+        }
+        queuedChars += text.size();
+        if (!notifyScheduled) {
+            notifyScheduled = true;
+            notify = true;
+        }
+        changed = updatePausedLocked();
+        nowPaused = paused;
+    }
+    if (changed) emit backpressureChanged(nowPaused);
+    if (notify) emit dataAvailable();
+    return !nowPaused;
+}
+
+bool LlmIngestQueue::take(QString *text, bool *isFinal, Source *source)
+{
+    bool changed = false;
+    bool nowPaused = false;
+    {
+        QMutexLocker locker(&mutex);
+        if (segments.isEmpty()) {
+            notifyScheduled = false;
+            return false;
+        }
+        const Segment segment = segments.takeFirst();
+        queuedChars -= segment.text.size();
+        // 取出的文本转入显示端积压，总量不变，背压状态由setConsumerBacklog更新
+        consumerBacklog += segment.text.size();
+        if (segments.isEmpty()) {
+            notifyScheduled = false;
+        }
+        *text = segment.text;
+        *isFinal = segment.isFinal;
+        if (source) {
+            *source = segment.source;
+        }
+        changed = updatePausedLocked();
+        nowPaused = paused;
+    }
+    if (changed) emit backpressureChanged(nowPaused);
+    return true;
+}
+
+void LlmIngestQueue::setConsumerBacklog(int chars)
+{
+    bool changed = false;
+    bool nowPaused = false;
+    {
+        QMutexLocker locker(&mutex);
+        consumerBacklog = qMax(0, chars);
+        changed = updatePausedLocked();
+        nowPaused = paused;
+    }
+    if (changed) emit backpressureChanged(nowPaused);
+}
+
+void LlmIngestQueue::clear()
+{
+    bool changed = false;
+    {
+        QMutexLocker locker(&mutex);
+        segments.clear();
+        queuedChars = 0;
+        consumerBacklog = 0;
+        changed = updatePausedLocked();
+    }
+    if (changed) emit backpressureChanged(false);
+}
+
+void LlmIngestQueue::clear(Source source)
+{
+    bool changed = false;
+    bool nowPaused = false;
+    {
+        QMutexLocker locker(&mutex);
+        for (int i = segments.size() - 1; i >= 0; --i) {
+            if (segments.at(i).source == source) {
+                queuedChars -= segments.at(i).text.size();
+                segments.removeAt(i);
+            }
+        }
+        changed = updatePausedLocked();
+        nowPaused = paused;
+    }
+    if (changed) emit backpressureChanged(nowPaused);
+}
+
+bool LlmIngestQueue::isPaused() const
+{
+    QMutexLocker locker(&mutex);
+    return paused;
+}
+
+bool LlmIngestQueue::updatePausedLocked()
+{
+    const int total = queuedChars + consumerBacklog;
+    if (!paused && total > highWatermark) {
+        paused = true;
+        qDebug() << "[LLM入队] 积压" << total << "字符，超过高水位，暂停读取";
+        return true;
+    }
+    if (paused && total <= lowWatermark) {
+        paused = false;
+        qDebug() << "[LLM入队] 积压回落至" << total << "字符，恢复读取";
+        return true;
+    }
+    return false;
+}
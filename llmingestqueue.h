@@ -0,0 +1,59 @@
+#ifndef LLMINGESTQUEUE_H
+#define LLMINGESTQUEUE_H
+
+#include <QObject>
+#include <QMutex>
+#include <QList>
+#include <QString>
+
+// LLM token 入队缓冲：生产者（网络线程/HTTP回调）与打字显示之间的有界合并队列。
+// - 同一事件循环轮次内到达的token合并为一段，消费端每轮只被通知一次；
+// - 队列积压 + 显示端积压超过高水位时发出backpressureChanged(true)，生产者暂停读取，
+//   回落到低水位以下再恢复，从而把压力传回TCP。
+// - 每段标记来源（socket llm_stream / NER会话），不同来源的文本不合并，可按来源单独清除。
+// push()/isPaused() 可在任意线程调用，其余接口在GUI线程使用。
+class LlmIngestQueue : public QObject
+{
+    Q_OBJECT
+public:
+    enum Source { SocketSource, NerSource };
+
+    explicit LlmIngestQueue(QObject *parent = nullptr);
+
+    void setWatermarks(int highChars, int lowChars);
+    // 追加token；返回false表示已处于背压状态，生产者应停止读取
+    bool push(const QString& text, bool isFinal, Source source = SocketSource);
+    // 取出一段合并后的token（段在isFinal及来源切换处切分）；队列为空返回false
+    bool take(QString *text, bool *isFinal, Source *source = nullptr);
+    // 显示端尚未输出的字符数，参与水位判断
+    void setConsumerBacklog(int chars);
+    void clear();
+    // 只丢弃指定来源尚未取出的段；显示端积压由调用方随后通过setConsumerBacklog更新
+    void clear(Source source);
+    bool isPaused() const;
+
+signals:
+    void dataAvailable();
+    void backpressureChanged(bool paused);
+
+private:
+    struct Segment {
+        QString text;
+        bool isFinal;
+        Source source;
+    };
+
+    // 调用方持有锁；返回背压状态是否发生变化
+    bool updatePausedLocked();
+
+    mutable QMutex mutex;
+    QList<Segment> segments;
+    int queuedChars;
+    int consumerBacklog;
+    int highWatermark;
+    int lowWatermark;
+    bool paused;
+    bool notifyScheduled;
+};
+
+#endif // LLMINGESTQUEUE_H
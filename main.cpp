@@ -1,10 +1,23 @@
 #include "widget.h"
 
 #include <QApplication>
+#ifdef FACE_EXTERNAL_RCC
+#include <QResource>
+#include <QDir>
+#include <QDebug>
+#endif
 
 int main(int argc, char *argv[])
 {
     QApplication a(argc, argv);
+#ifdef FACE_EXTERNAL_RCC
+    // 外部资源包：registerResource会内存映射整个rcc文件，图片直接从映射内存读取
+    const QDir appDir(QCoreApplication::applicationDirPath());
+    if (!QResource::registerResource(appDir.filePath("qt_face.rcc"))
+        && !QResource::registerResource(appDir.filePath("../qt_face.rcc"))) {
+        qDebug() << "[资源] 未找到qt_face.rcc，表情资源将不可用";
+    }
+#endif
     Widget w;
     w.show();
     //w.showFullScreen();//全屏
@@ -0,0 +1,370 @@
+#include "nersessionmanager.h"
+#include "nerstreamparser.h"
+#include "llmingestqueue.h"
+#include <QNetworkAccessManager>
+#include <QNetworkReply>
+#include <QHttpMultiPart>
+#include <QUrlQuery>
+#include <QFile>
+#include <QScopedPointer>
+#include <QTextCodec>
+#include <QTextDecoder>
+#include <QVector>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDebug>
+#ifndef QT_NO_SSL
+#include <QSslConfiguration>
+#endif
+
+namespace {
+// 同时保留的会话数（含已结束、可再次显示的会话）
+const int kMaxSessions = 4;
+// 后台会话通道缓存上限，超出后丢弃最早的文本
+const int kMaxLaneChars = 256 * 1024;
+// 显示会话的通道只保留显示区能回放的末尾部分（显示区为3行、无回滚），正文已逐段送入显示队列
+const int kDisplayedLaneChars = 4 * 1024;
+// 回复读缓冲上限：显示会话背压期间不读取时，由TCP窗口限制服务端发送
+const qint64 kReplyReadBufferBytes = 64 * 1024;
+// 空闲多久后重新预连接；低于常见服务端keep-alive超时(60s)
+const int kRewarmIdleMs = 45 * 1000;
+}
+
+struct NerSession {
+    QString memoryId;
+    QNetworkReply *reply = nullptr;
+    // 有状态解码器：被分包截断的多字节字符留到下一块拼接
+    QScopedPointer<QTextDecoder> decoder;
+    // 首次readyRead时按Content-Type创建
+    QScopedPointer<NerStreamParser> parser;
+    QString lane;     // 本会话已收到的正文，切换显示时回放；显示中只保留末尾部分
+    QString emotion;  // 最近一次情绪
+    bool finished = false;
+    QElapsedTimer sinceRequest; // 首字延迟计时
+    bool gotFirstToken = false;
+};
+
+NerSessionManager::NerSessionManager(QNetworkAccessManager *nam, LlmIngestQueue *ingest, QObject *parent)
+    : QObject(parent)
+    , nam(nam)
+    , ingest(ingest)
+    , displayPolicy(LatestForeground)
+    , warmTimer(new QTimer(this))
+{
+    warmTimer->setSingleShot(true);
+    warmTimer->setInterval(kRewarmIdleMs);
+    connect(warmTimer, &QTimer::timeout, this, &NerSessionManager::warmUp);
+}
+
+NerSessionManager::~NerSessionManager()
+{
+    cancelAll();
+}
+
+QNetworkRequest NerSessionManager::makeRequest(const QUrl& baseUrl, const QString& memoryId)
+{
+    QUrl url(baseUrl);
+    QString path = url.path();
+    if (!path.endsWith('/')) path += '/';
+    path += "ner";
+    url.setPath(path);
+    QUrlQuery query(url);
+    query.addQueryItem("memoryId", memoryId);
+    url.setQuery(query);
+    QNetworkRequest req(url);
+    // HTTP/2 经TLS的ALPN协商，服务端不支持时自动回落HTTP/1.1；明文h2c需升级握手，带请求体的POST不适用
+    if (url.scheme() == QLatin1String("https")) {
+        req.setAttribute(QNetworkRequest::Http2AllowedAttribute, true);
+    }
+    return req;
+}
+
+void NerSessionManager::setWarmupUrl(const QUrl& baseUrl)
+{
+    if (baseUrl.host() == warmUrl.host() && baseUrl.scheme() == warmUrl.scheme()
+        && baseUrl.port() == warmUrl.port()) {
+        // 目标不变：连接即将被使用，推迟下次预连接
+        warmTimer->start();
+        return;
+    }
+    warmUrl = baseUrl;
+    warmUp();
+}
+
+void NerSessionManager::warmUp()
+{
+    if (!warmUrl.isValid() || warmUrl.host().isEmpty()) {
+        return;
+    }
+    // 已有空闲连接时Qt直接复用，不会重复握手
+    if (warmUrl.scheme() == QLatin1String("https")) {
+#ifndef QT_NO_SSL
+        QSslConfiguration conf = QSslConfiguration::defaultConfiguration();
+        conf.setAllowedNextProtocols({QSslConfiguration::ALPNProtocolHTTP2, QSslConfiguration::NextProtocolHttp1_1});
+        nam->connectToHostEncrypted(warmUrl.host(), quint16(warmUrl.port(443)), conf);
+#endif
+    } else {
+        nam->connectToHost(warmUrl.host(), quint16(warmUrl.port(80)));
+    }
+    // 仍有进行中的会话才继续定时预连接；全部结束后只在最后一次结束时补一次，之后停止，
+    // 长时间无人使用时不再反复握手
+    for (const NerSession *s : qAsConst(sessions)) {
+        if (!s->finished) {
+            warmTimer->start();
+            return;
+        }
+    }
+    warmTimer->stop();
+}
+
+void NerSessionManager::startJson(const QUrl& baseUrl, const QString& memoryId, const QByteArray& json, bool foreground)
+{
+    setWarmupUrl(baseUrl);
+    QNetworkRequest req = makeRequest(baseUrl, memoryId);
+    req.setHeader(QNetworkRequest::ContentTypeHeader, QString("application/json"));
+    startSession(memoryId, nam->post(req, json), foreground);
+}
+
+bool NerSessionManager::startMultipart(const QUrl& baseUrl, const QString& memoryId, const QString& imagePath, bool foreground)
+{
+    QFile* file = new QFile(imagePath);
+    if (!file->open(QIODevice::ReadOnly)) {
+        delete file;
+        return false;
+    }
+    setWarmupUrl(baseUrl);
+    QHttpMultiPart* multi = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+    QHttpPart filePart;
+    filePart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant("form-data; name=\"imageFile\"; filename=\"upload.jpg\""));
+    filePart.setBodyDevice(file);
+    file->setParent(multi); // multi析构时释放
+    multi->append(filePart);
+
+    QNetworkReply *reply = nam->post(makeRequest(baseUrl, memoryId), multi);
+    multi->setParent(reply); // reply完成后释放
+    startSession(memoryId, reply, foreground);
+    return true;
+}
+
+void NerSessionManager::startSession(const QString& memoryId, QNetworkReply *reply, bool foreground)
+{
+    // 重新发起正在显示的会话：新回复直接接管显示
+    if (memoryId == displayedId) {
+        foreground = true;
+    }
+    removeSession(memoryId);
+
+    NerSession *s = new NerSession;
+    s->memoryId = memoryId;
+    s->reply = reply;
+    s->decoder.reset(QTextCodec::codecForName("UTF-8")->makeDecoder());
+    s->sinceRequest.start();
+    reply->setReadBufferSize(kReplyReadBufferBytes);
+    sessions.insert(memoryId, s);
+    order.append(memoryId);
+
+    connect(reply, &QNetworkReply::readyRead, this, [this, s]() { readSession(s); });
+    connect(reply, &QNetworkReply::finished, this, [this, s]() { finishSession(s); });
+#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
+    connect(reply, &QNetworkReply::errorOccurred, this, [this, s]() { failSession(s); });
+#else
+    connect(reply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), this, [this, s]() { failSession(s); });
+#endif
+
+    if (foreground) {
+        const NerSession *current = sessions.value(displayedId);
+        if (displayPolicy == LatestForeground || !current || current->finished) {
+            showSession(memoryId);
+        } else {
+            waitingId = memoryId;
+        }
+    }
+    evictSessions();
+}
+
+bool NerSessionManager::showSession(const QString& memoryId)
+{
+    NerSession *s = sessions.value(memoryId);
+    if (!s) {
+        return false;
+    }
+    displayedId = memoryId;
+    if (waitingId == memoryId) {
+        waitingId.clear();
+    }
+    // 先让显示端清空，再回放本会话通道
+    emit displayedSessionChanged(memoryId);
+    if (!s->emotion.isEmpty()) {
+        emit emotionReceived(s->emotion);
+    }
+    if (!s->lane.isEmpty()) {
+        ingest->push(s->lane, false, LlmIngestQueue::NerSource);
+        emit activity();
+        trimLane(s);
+    }
+    if (s->finished) {
+        ingest->push(QString(), true, LlmIngestQueue::NerSource);
+    } else {
+        readSession(s);
+    }
+    return true;
+}
+
+bool NerSessionManager::isDisplayed(const NerSession *s) const
+{
+    return s && s->memoryId == displayedId;
+}
+
+void NerSessionManager::readSession(NerSession *s)
+{
+    if (!s->reply) return;
+    // 显示会话背压中：数据留在reply缓冲区，待水位回落后再读；后台会话只写自己的通道，不受影响
+    if (isDisplayed(s) && ingest->isPaused() && !s->reply->isFinished()) return;
+    const QByteArray chunk = s->reply->readAll();
+    if (chunk.isEmpty()) return;
+    if (!s->parser) {
+        s->parser.reset(NerStreamParser::create(s->reply->rawHeader("Content-Type")));
+    }
+    QVector<NerStreamEvent> events;
+    s->parser->feed(s->decoder->toUnicode(chunk), &events);
+    for (const NerStreamEvent& ev : events) {
+        deliverEmotion(s, ev.emotion);
+        deliverText(s, ev.text);
+    }
+}
+
+void NerSessionManager::deliverText(NerSession *s, const QString& text)
+{
+    if (text.isEmpty()) return;
+    if (!s->gotFirstToken) {
+        s->gotFirstToken = true;
+        const bool http2 = s->reply && s->reply->attribute(QNetworkRequest::HTTP2WasUsedAttribute).toBool();
+        emit firstTokenLatency(s->memoryId, s->sinceRequest.elapsed(), http2);
+    }
+    s->lane.append(text);
+    trimLane(s);
+    if (isDisplayed(s)) {
+        ingest->push(text, false, LlmIngestQueue::NerSource);
+        emit activity();
+    }
+}
+
+void NerSessionManager::trimLane(NerSession *s) const
+{
+    const int limit = isDisplayed(s) ? kDisplayedLaneChars : kMaxLaneChars;
+    if (s->lane.size() > limit) {
+        s->lane.remove(0, s->lane.size() - limit);
+    }
+}
+
+void NerSessionManager::deliverEmotion(NerSession *s, const QString& emotion)
+{
+    if (emotion.isEmpty()) return;
+    s->emotion = emotion;
+    if (isDisplayed(s)) {
+        emit emotionReceived(emotion);
+    }
+}
+
+void NerSessionManager::failSession(NerSession *s)
+{
+    const QString err = s->reply ? s->reply->errorString() : QStringLiteral("unknown error");
+    // 错误文本进入会话通道，随后的finished负责结束标记；不计入首字延迟
+    s->gotFirstToken = true;
+    deliverText(s, QStringLiteral("[网络错误] ") + err + "\n");
+}
+
+void NerSessionManager::finishSession(NerSession *s)
+{
+    // 读出剩余数据后再标记结束，结束标记与文本经同一队列按序投递
+    readSession(s);
+    if (s->parser) {
+        // 输出未以分隔符结尾的最后一帧
+        QVector<NerStreamEvent> events;
+        s->parser->finish(&events);
+        for (const NerStreamEvent& ev : events) {
+            deliverEmotion(s, ev.emotion);
+            deliverText(s, ev.text);
+        }
+    }
+    s->finished = true;
+    // 连接刚被使用过，从此刻重新计算空闲时间
+    if (warmUrl.isValid()) {
+        warmTimer->start();
+    }
+    s->decoder.reset();
+    s->parser.reset();
+    if (s->reply) {
+        s->reply->deleteLater();
+        s->reply = nullptr;
+    }
+    if (isDisplayed(s)) {
+        ingest->push(QString(), true, LlmIngestQueue::NerSource);
+    }
+}
+
+void NerSessionManager::displayDrained()
+{
+    // 当前回答已结束且全部上屏，再切到排队的前台会话，避免截断正在打字的内容
+    const NerSession *current = sessions.value(displayedId);
+    if (!waitingId.isEmpty() && (!current || current->finished)) {
+        showSession(waitingId);
+    }
+}
+
+void NerSessionManager::resumeDisplayed()
+{
+    if (NerSession *s = sessions.value(displayedId)) {
+        readSession(s);
+    }
+}
+
+void NerSessionManager::removeSession(const QString& memoryId)
+{
+    NerSession *s = sessions.take(memoryId);
+    if (!s) return;
+    order.removeAll(memoryId);
+    if (s->reply) {
+        disconnect(s->reply, nullptr, this, nullptr);
+        s->reply->abort();
+        s->reply->deleteLater();
+    }
+    if (waitingId == memoryId) {
+        waitingId.clear();
+    }
+    delete s;
+}
+
+void NerSessionManager::cancelSession(const QString& memoryId)
+{
+    const bool wasDisplayed = (memoryId == displayedId);
+    removeSession(memoryId);
+    if (wasDisplayed && ingest) {
+        // 显示中的回答被取消：补一个结束标记，打字显示输出已收到的部分后停止
+        ingest->push(QString(), true, LlmIngestQueue::NerSource);
+        displayedId.clear();
+    }
+}
+
+void NerSessionManager::cancelAll()
+{
+    const QStringList ids = order;
+    for (const QString& id : ids) {
+        removeSession(id);
+    }
+    displayedId.clear();
+}
+
+void NerSessionManager::evictSessions()
+{
+    // 优先淘汰最早的已结束会话，其次最早的后台会话；显示中和排队中的会话不淘汰
+    for (int pass = 0; pass < 2 && sessions.size() > kMaxSessions; ++pass) {
+        const QStringList ids = order;
+        for (const QString& id : ids) {
+            if (sessions.size() <= kMaxSessions) break;
+            if (id == displayedId || id == waitingId) continue;
+            if (pass == 0 && !sessions.value(id)->finished) continue;
+            removeSession(id);
+        }
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef NERSESSIONMANAGER_H
+#define NERSESSIONMANAGER_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include <QUrl>
+#include <QNetworkRequest>
+
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+class LlmIngestQueue;
+struct NerSession;
+
+// /ner 流式会话管理：按 memoryId 区分会话，每个会话有独立的 reply、UTF-8解码器、分帧解析器和文本通道。
+// 同一时刻只有一个会话接到打字显示（LlmIngestQueue），其余会话在后台把文本存入自己的通道，
+// 例如正在显示一个回答时预取用药回答，切换显示时回放通道内容并继续实时输出。
+// 所有接口在GUI线程调用。
+class NerSessionManager : public QObject
+{
+    Q_OBJECT
+public:
+    enum DisplayPolicy {
+        // 新的前台会话立即接管显示
+        LatestForeground,
+        // 当前会话结束前保持显示，新的前台会话排队，结束后再切换
+        KeepCurrentUntilFinished
+    };
+
+    NerSessionManager(QNetworkAccessManager *nam, LlmIngestQueue *ingest, QObject *parent = nullptr);
+    ~NerSessionManager() override;
+
+    void setDisplayPolicy(DisplayPolicy policy) { displayPolicy = policy; }
+    DisplayPolicy policy() const { return displayPolicy; }
+
+    // 发起会话；同一 memoryId 的旧会话会被取消，其他会话不受影响。
+    // foreground=false 为预取：只缓存到会话通道，需 showSession() 才显示
+    void startJson(const QUrl& baseUrl, const QString& memoryId, const QByteArray& json, bool foreground);
+    // 文件无法打开时返回false
+    bool startMultipart(const QUrl& baseUrl, const QString& memoryId, const QString& imagePath, bool foreground);
+
+    // 把指定会话切到显示：回放已缓存文本，未结束则继续实时输出
+    bool showSession(const QString& memoryId);
+    QString displayedSession() const { return displayedId; }
+    bool hasSession(const QString& memoryId) const { return sessions.contains(memoryId); }
+    void cancelSession(const QString& memoryId);
+    void cancelAll();
+
+    // 背压解除后读取显示会话在reply中暂存的数据
+    void resumeDisplayed();
+    // 打字显示已输出完当前回答（由显示端调用），KeepCurrentUntilFinished 据此切换
+    void displayDrained();
+
+    // 预连接：启动时及空闲后对后端发起TCP(/TLS)握手，首个请求直接复用连接池中的连接。
+    // 每次发起会话也会更新预连接目标
+    void setWarmupUrl(const QUrl& baseUrl);
+    void warmUp();
+
+    static QNetworkRequest makeRequest(const QUrl& baseUrl, const QString& memoryId);
+
+signals:
+    // 显示会话切换：接收方应在此清空打字显示，之后才会收到新会话的文本
+    void displayedSessionChanged(const QString& memoryId);
+    // 显示会话中的情绪
+    void emotionReceived(const QString& emotion);
+    // 显示会话收到正文
+    void activity();
+    // 首字延迟：请求发出到第一段正文解析完成
+    void firstTokenLatency(const QString& memoryId, qint64 ms, bool http2);
+
+private:
+    void startSession(const QString& memoryId, QNetworkReply *reply, bool foreground);
+    void readSession(NerSession *s);
+    void finishSession(NerSession *s);
+    void failSession(NerSession *s);
+    void deliverText(NerSession *s, const QString& text);
+    void deliverEmotion(NerSession *s, const QString& emotion);
+    void trimLane(NerSession *s) const;
+    void removeSession(const QString& memoryId);
+    void evictSessions();
+    bool isDisplayed(const NerSession *s) const;
+
+    QNetworkAccessManager *nam;
+    LlmIngestQueue *ingest;
+    DisplayPolicy displayPolicy;
+    QHash<QString, NerSession*> sessions;
+    QStringList order;    // 发起顺序，淘汰时从最早的开始
+    QString displayedId;
+    QString waitingId;    // KeepCurrentUntilFinished 下排队等待显示的会话
+    QUrl warmUrl;
+    QTimer *warmTimer;    // 空闲一段时间后重新预连接，避免连接被服务端回收后首个请求重新握手
+};
+
+#endif // NERSESSIONMANAGER_H
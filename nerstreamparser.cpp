@@ -0,0 +1,231 @@
+#include "nerstreamparser.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDebug>
+#include <initializer_list>
+
+namespace {
+// 单帧/单行上限，防止异常回复无限制累积
+const int kMaxLineChars = 64 * 1024;
+
+// 帧负载 -> 事件：JSON对象取 text/token/content 与 emotion；JSON字符串取其值；否则按原文
+NerStreamEvent interpretPayload(const QString& payload)
+{
+    NerStreamEvent ev;
+    const QString trimmed = payload.trimmed();
+    if (trimmed.startsWith(QLatin1Char('{'))) {
+        QJsonParseError err;
+        const QJsonDocument doc = QJsonDocument::fromJson(trimmed.toUtf8(), &err);
+        if (err.error == QJsonParseError::NoError && doc.isObject()) {
+            const QJsonObject obj = doc.object();
+            for (const char *key : {"text", "token", "content"}) {
+                const QJsonValue v = obj.value(QLatin1String(key));
+                if (v.isString()) {
+                    ev.text = v.toString();
+                    break;
+                }
+            }
+            ev.emotion = obj.value(QStringLiteral("emotion")).toString();
+            return ev;
+        }
+    } else if (trimmed.startsWith(QLatin1Char('"'))) {
+        // Qt5 的 QJsonDocument 不接受顶层字符串，包一层数组再解析
+        QJsonParseError err;
+        const QJsonDocument doc = QJsonDocument::fromJson("[" + trimmed.toUtf8() + "]", &err);
+        if (err.error == QJsonParseError::NoError && doc.isArray()) {
+            ev.text = doc.array().at(0).toString();
+            return ev;
+        }
+    }
+    ev.text = payload;
+    return ev;
+}
+
+void appendEvent(const NerStreamEvent& ev, QVector<NerStreamEvent> *out)
+{
+    if (!ev.text.isEmpty() || !ev.emotion.isEmpty()) {
+        out->append(ev);
+    }
+}
+
+// 按行切分的公共部分：缓存不完整的末行，去掉行尾\r。
+// 超长行整行丢弃：丢弃模式下跳过输入直到下一个换行，行的剩余部分不会被当成新行显示
+class LineParser : public NerStreamParser
+{
+public:
+    void feed(const QString& chunk, QVector<NerStreamEvent> *out) override
+    {
+        int skip = 0;
+        if (discarding) {
+            const int nl = chunk.indexOf(QLatin1Char('\n'));
+            if (nl < 0) {
+                return;
+            }
+            discarding = false;
+            skip = nl + 1;
+        }
+        pending.append(chunk.midRef(skip));
+        int from = 0;
+        for (int nl = pending.indexOf(QLatin1Char('\n')); nl >= 0;
+             nl = pending.indexOf(QLatin1Char('\n'), from)) {
+            int end = nl;
+            if (end > from && pending.at(end - 1) == QLatin1Char('\r')) {
+                --end;
+            }
+            handleLine(pending.mid(from, end - from), out);
+            from = nl + 1;
+        }
+        pending.remove(0, from);
+        if (pending.size() > kMaxLineChars) {
+            qDebug() << "[NER解析] 单行超过" << kMaxLineChars << "字符，丢弃至下一行";
+            pending.clear();
+            discarding = true;
+            handleDiscardedLine();
+        }
+    }
+
+    void finish(QVector<NerStreamEvent> *out) override
+    {
+        if (discarding) {
+            discarding = false;
+        } else if (!pending.isEmpty()) {
+            if (pending.endsWith(QLatin1Char('\r'))) {
+                pending.chop(1);
+            }
+            handleLine(pending, out);
+            pending.clear();
+        }
+        handleEnd(out);
+    }
+
+protected:
+    virtual void handleLine(const QString& line, QVector<NerStreamEvent> *out) = 0;
+    virtual void handleEnd(QVector<NerStreamEvent> *out) { Q_UNUSED(out); }
+    // 当前行因超长被丢弃
+    virtual void handleDiscardedLine() {}
+
+private:
+    QString pending;
+    bool discarding = false;
+};
+
+// 原始分片：全部内容即正文
+class RawParser : public NerStreamParser
+{
+public:
+    void feed(const QString& chunk, QVector<NerStreamEvent> *out) override
+    {
+        NerStreamEvent ev;
+        ev.text = chunk;
+        appendEvent(ev, out);
+    }
+};
+
+// SSE：data: 行累积，空行结束一个事件；event: emotion 的数据作为情绪
+class SseParser : public LineParser
+{
+protected:
+    void handleLine(const QString& line, QVector<NerStreamEvent> *out) override
+    {
+        if (line.isEmpty()) {
+            dispatch(out);
+            return;
+        }
+        if (discardingEvent) {
+            return; // 丢弃模式：等待事件边界（空行）
+        }
+        if (line.startsWith(QLatin1Char(':'))) {
+            return; // 注释/心跳
+        }
+        const int colon = line.indexOf(QLatin1Char(':'));
+        const QString field = colon < 0 ? line : line.left(colon);
+        QString value = colon < 0 ? QString() : line.mid(colon + 1);
+        if (value.startsWith(QLatin1Char(' '))) {
+            value.remove(0, 1);
+        }
+        if (field == QLatin1String("data")) {
+            if (hasData) {
+                data.append(QLatin1Char('\n'));
+            }
+            data.append(value);
+            hasData = true;
+            if (data.size() > kMaxLineChars) {
+                qDebug() << "[NER解析] SSE事件超过" << kMaxLineChars << "字符，丢弃至事件结束";
+                discardEvent();
+            }
+        } else if (field == QLatin1String("event")) {
+            eventType = value;
+        }
+        // id/retry 与未知字段忽略
+    }
+
+    void handleEnd(QVector<NerStreamEvent> *out) override
+    {
+        dispatch(out);
+    }
+
+    void handleDiscardedLine() override
+    {
+        // 事件的一部分已丢失，整个事件都不再显示
+        discardEvent();
+    }
+
+private:
+    void discardEvent()
+    {
+        data.clear();
+        hasData = false;
+        discardingEvent = true;
+    }
+
+    void dispatch(QVector<NerStreamEvent> *out)
+    {
+        if (hasData && !discardingEvent) {
+            if (eventType == QLatin1String("emotion")) {
+                NerStreamEvent ev;
+                ev.emotion = data.trimmed();
+                appendEvent(ev, out);
+            } else if (data != QLatin1String("[DONE]")) {
+                appendEvent(interpretPayload(data), out);
+            }
+        }
+        data.clear();
+        hasData = false;
+        discardingEvent = false;
+        eventType.clear();
+    }
+
+    QString data;
+    QString eventType;
+    bool hasData = false;
+    bool discardingEvent = false;
+};
+
+// NDJSON：每行一个JSON值（对象或字符串），非JSON行按原文显示
+class NdjsonParser : public LineParser
+{
+protected:
+    void handleLine(const QString& line, QVector<NerStreamEvent> *out) override
+    {
+        if (line.trimmed().isEmpty()) {
+            return;
+        }
+        appendEvent(interpretPayload(line), out);
+    }
+};
+}
+
+NerStreamParser *NerStreamParser::create(const QByteArray& contentType)
+{
+    // 只看媒体类型，忽略 ;charset= 等参数
+    const QByteArray mime = contentType.split(';').first().trimmed().toLower();
+    if (mime == "text/event-stream") {
+        return new SseParser;
+    }
+    if (mime == "application/x-ndjson" || mime == "application/ndjson"
+        || mime == "application/stream+json" || mime == "application/jsonl") {
+        return new NdjsonParser;
+    }
+    return new RawParser;
+}
@@ -0,0 +1,31 @@
+#ifndef NERSTREAMPARSER_H
+#define NERSTREAMPARSER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+
+// /ner 流式回复中解析出的一个事件：显示文本和/或情绪
+struct NerStreamEvent {
+    QString text;
+    QString emotion;
+};
+
+// /ner 回复分帧解析：Flux<String> 按内容协商可能是原始分片、SSE(data:帧)或NDJSON。
+// 输入为已解码的文本分块，输出只含正文与情绪，分帧字节不会进入显示。
+class NerStreamParser
+{
+public:
+    virtual ~NerStreamParser() = default;
+
+    // 追加一块文本，完整帧解析为事件追加到out
+    virtual void feed(const QString& chunk, QVector<NerStreamEvent> *out) = 0;
+    // 回复结束：输出尚未以分隔符结尾的最后一帧
+    virtual void finish(QVector<NerStreamEvent> *out) { Q_UNUSED(out); }
+
+    // 按响应 Content-Type 选择解析器：
+    // text/event-stream -> SSE；application/x-ndjson、application/stream+json 等 -> NDJSON；其余按原始文本
+    static NerStreamParser *create(const QByteArray& contentType);
+};
+
+#endif // NERSTREAMPARSER_H
@@ -0,0 +1,189 @@
+#include "overlaytextview.h"
+#include <QPainter>
+#include <QPaintEvent>
+#include <QTextLayout>
+#include <QTextOption>
+
+OverlayTextView::OverlayTextView(QWidget *parent)
+    : QWidget(parent)
+    , visibleLineCount(1)
+    , scrollbackLineCount(0)
+{
+    // 背景透明，由下层表情画布提供
+    setAttribute(Qt::WA_TranslucentBackground);
+    setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    updateFixedHeight();
+}
+
+void OverlayTextView::setVisibleLines(int lines)
+{
+    visibleLineCount = qMax(1, lines);
+    updateFixedHeight();
+    trimScrollback();
+    update();
+}
+
+void OverlayTextView::setScrollbackLines(int lines)
+{
+    scrollbackLineCount = qMax(0, lines);
+    trimScrollback();
+}
+
+void OverlayTextView::setText(const QString& text)
+{
+    content = text;
+    relayout();
+    update();
+}
+
+void OverlayTextView::clear()
+{
+    if (content.isEmpty()) {
+        return;
+    }
+    content.clear();
+    lines.clear();
+    update();
+}
+
+void OverlayTextView::appendText(const QString& text)
+{
+    if (text.isEmpty()) {
+        return;
+    }
+    // 只有末行可能因新字符改变断行，之前的行保持不动
+    const int oldCount = lines.size();
+    int reflowFrom = content.size();
+    if (!lines.isEmpty()) {
+        reflowFrom = lines.last().start;
+        lines.removeLast();
+    }
+    content.append(text);
+    wrapFrom(reflowFrom);
+    const bool scrolled = lines.size() > oldCount && lines.size() > visibleLineCount;
+    trimScrollback();
+
+    const QRect area = contentsRect();
+    if (scrolled) {
+        // 新增行把旧行顶上去：整个可见区域都要重绘
+        update(area);
+        return;
+    }
+    // 未滚动：只重绘从原末行开始的行
+    const int lineH = fontMetrics().lineSpacing();
+    const int row = qMax(0, oldCount - 1 - firstVisibleLine());
+    update(QRect(area.left(), area.top() + row * lineH, area.width(), area.height() - row * lineH));
+}
+
+void OverlayTextView::relayout()
+{
+    lines.clear();
+    wrapFrom(0);
+    trimScrollback();
+}
+
+void OverlayTextView::wrapFrom(int offset)
+{
+    const int width = qMax(1, contentsRect().width());
+    QTextOption option;
+    option.setWrapMode(QTextOption::WrapAtWordBoundaryOrAnywhere);
+
+    int from = offset;
+    for (;;) {
+        const int newline = content.indexOf(QLatin1Char('\n'), from);
+        const int end = newline < 0 ? content.size() : newline;
+        const QString paragraph = content.mid(from, end - from);
+
+        if (paragraph.isEmpty()) {
+            Line line;
+            line.start = from;
+            lines.append(line);
+        } else {
+            QTextLayout layout(paragraph, font());
+            layout.setTextOption(option);
+            layout.beginLayout();
+            for (QTextLine tl = layout.createLine(); tl.isValid(); tl = layout.createLine()) {
+                tl.setLineWidth(width);
+                Line line;
+                line.start = from + tl.textStart();
+                line.glyphs.setText(paragraph.mid(tl.textStart(), tl.textLength()));
+                line.glyphs.setTextFormat(Qt::PlainText);
+                line.glyphs.setPerformanceHint(QStaticText::AggressiveCaching);
+                line.glyphs.prepare(QTransform(), font());
+                lines.append(line);
+            }
+            layout.endLayout();
+        }
+
+        if (newline < 0) {
+            break;
+        }
+        from = newline + 1;
+    }
+}
+
+void OverlayTextView::trimScrollback()
+{
+    const int keep = visibleLineCount + scrollbackLineCount;
+    if (lines.size() <= keep) {
+        return;
+    }
+    const int drop = lines.size() - keep;
+    const int cut = lines.at(drop).start;
+    lines.remove(0, drop);
+    content.remove(0, cut);
+    for (Line &line : lines) {
+        line.start -= cut;
+    }
+}
+
+int OverlayTextView::firstVisibleLine() const
+{
+    return qMax(0, lines.size() - visibleLineCount);
+}
+
+void OverlayTextView::updateFixedHeight()
+{
+    const QMargins m = contentsMargins();
+    setFixedHeight(fontMetrics().lineSpacing() * visibleLineCount + m.top() + m.bottom());
+}
+
+void OverlayTextView::paintEvent(QPaintEvent *event)
+{
+    if (lines.isEmpty()) {
+        return;
+    }
+    QPainter painter(this);
+    painter.setFont(font());
+    painter.setPen(palette().color(QPalette::WindowText));
+
+    const QRect area = contentsRect();
+    const int lineH = fontMetrics().lineSpacing();
+    const QRect dirty = event->rect();
+    int y = area.top();
+    // 只画最后 visibleLineCount 行，相当于始终滚动到底
+    for (int i = firstVisibleLine(); i < lines.size(); ++i, y += lineH) {
+        if (y + lineH <= dirty.top() || y >= dirty.bottom() + 1) {
+            continue;
+        }
+        painter.drawStaticText(area.left(), y, lines.at(i).glyphs);
+    }
+}
+
+void OverlayTextView::resizeEvent(QResizeEvent *event)
+{
+    QWidget::resizeEvent(event);
+    relayout();
+}
+
+void OverlayTextView::changeEvent(QEvent *event)
+{
+    QWidget::changeEvent(event);
+    if (event->type() == QEvent::FontChange) {
+        updateFixedHeight();
+        relayout();
+        update();
+    } else if (event->type() == QEvent::PaletteChange) {
+        update();
+    }
+}
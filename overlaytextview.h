@@ -0,0 +1,51 @@
+#ifndef OVERLAYTEXTVIEW_H
+#define OVERLAYTEXTVIEW_H
+
+#include <QWidget>
+#include <QStaticText>
+#include <QVector>
+
+// 浮在表情上的只读文本：按行缓存QStaticText，追加时只重排末行，始终显示最后几行
+// 替代QPlainTextEdit，无文档/光标/滚动条开销
+class OverlayTextView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit OverlayTextView(QWidget *parent = nullptr);
+
+    // 可见行数决定固定高度；超出部分按行向上滚出
+    void setVisibleLines(int lines);
+    int visibleLines() const { return visibleLineCount; }
+    // 可见区域之外保留的行数，超出后从头部裁掉
+    void setScrollbackLines(int lines);
+
+    void setText(const QString& text);
+    void appendText(const QString& text);
+    void clear();
+    QString text() const { return content; }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
+
+private:
+    struct Line {
+        int start;          // 在content中的起始偏移
+        QStaticText glyphs; // 已排版的字形缓存
+    };
+
+    void relayout();
+    // 从offset处开始断行并追加到lines
+    void wrapFrom(int offset);
+    void trimScrollback();
+    void updateFixedHeight();
+    int firstVisibleLine() const;
+
+    QString content;
+    QVector<Line> lines;
+    int visibleLineCount;
+    int scrollbackLineCount;
+};
+
+#endif // OVERLAYTEXTVIEW_H
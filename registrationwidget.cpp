@@ -1,14 +1,20 @@
 #include "registrationwidget.h"
 #include <QApplication>
 #include <QMessageBox>
-#include <QStandardPaths>
-#include <QDir>
 #include <QDebug>
 #include <QCoreApplication>
 #include <QMouseEvent>
+#include <QScreen>
+#include <cmath>
 
 const QString RegistrationWidget::GROUP_ID = "X16BAC";
 
+// 电平（0~1，满幅为1）换算为dBFS
+static float levelToDb(float level)
+{
+    return level > 0.0f ? 20.0f * std::log10(level) : -96.0f;
+}
+
 RegistrationWidget::RegistrationWidget(QWidget *parent)
     : QWidget(parent)
     , stackedWidget(nullptr)
@@ -23,9 +29,11 @@ RegistrationWidget::RegistrationWidget(QWidget *parent)
     , recordButton(nullptr)
     , recordStatusLabel(nullptr)
     , recordingProgressBar(nullptr)
+    , levelMeter(nullptr)
     , recordingTimer(new QTimer(this))
-    , audioRecorder(nullptr)
+    , voiceCapture(new VoiceCapture(this))
     , recordingInProgress(false)
+    , autoStopQueued(false)
     , usersScrollArea(nullptr)
     , usersWidget(nullptr)
     , usersLayout(nullptr)
@@ -39,6 +47,13 @@ RegistrationWidget::RegistrationWidget(QWidget *parent)
     , networkManager(new QNetworkAccessManager(this))
     , currentReply(nullptr)
     , serverBaseUrl("http://81.69.221.200:8081")  // 公网服务器地址
+    , streamingUpload(nullptr)
+    , streamingUploadEnabled(qEnvironmentVariableIntValue("REG_STREAMING_UPLOAD") != 0)
+    , streamingSubmitPending(false)
+    , streamedBytes(0)
+    , streamedBodyClosed(false)
+    , streamedResultReady(false)
+    , streamedStatus(0)
 {
     setAttribute(Qt::WA_StyledBackground);
     setStyleSheet("background-color:#1e1e1e;");
@@ -67,10 +82,14 @@ RegistrationWidget::RegistrationWidget(QWidget *parent)
         qDebug() << "  - 第" << (i+1) << "次强制设置后状态:" << networkManager->networkAccessible();
     }
     
-    // 初始化录音文件夹（使用Desktop路径）
-    audioOutputDir = QStandardPaths::writableLocation(QStandardPaths::DesktopLocation) + "/VoiceRegistration";
-    QDir().mkpath(audioOutputDir);
-    qDebug() << "录音文件保存路径:" << audioOutputDir;
+    // 录音只保存在内存：按最长录音时长预分配缓冲（留1秒余量给手动停止的延迟）
+    voiceCapture->setMaxDurationMs(RECORDING_DURATION_MS + 1000);
+    connect(voiceCapture, &VoiceCapture::pcmCaptured, this, &RegistrationWidget::onPcmCaptured);
+    // 电平表每个屏幕刷新周期最多更新一次
+    const QScreen *screen = QApplication::primaryScreen();
+    const qreal refreshRate = screen ? screen->refreshRate() : 60.0;
+    voiceCapture->setLevelIntervalMs(qRound(1000.0 / qMax<qreal>(1.0, refreshRate)));
+    connect(voiceCapture, &VoiceCapture::levelChanged, this, &RegistrationWidget::onAudioLevel);
     
     // 初始化关系选项
     relationOptions << "爸爸" << "妈妈" << "老公" << "老婆" 
@@ -92,9 +111,7 @@ RegistrationWidget::RegistrationWidget(QWidget *parent)
 
 RegistrationWidget::~RegistrationWidget()
 {
-    if (audioRecorder && audioRecorder->state() == QMediaRecorder::RecordingState) {
-        audioRecorder->stop();
-    }
+    voiceCapture->stop();
     
     // 清理网络请求
     if (currentReply) {
@@ -489,6 +506,29 @@ void RegistrationWidget::setupStep3()
     recordingProgressBar->hide(); // 初始隐藏
     recordLayout->addWidget(recordingProgressBar);
     
+    // 输入电平：条长为均方根（-60~0dBFS），文字为峰值
+    levelMeter = new QProgressBar();
+    levelMeter->setRange(0, 100);
+    levelMeter->setValue(0);
+    levelMeter->setFormat("无声");
+    levelMeter->setStyleSheet(
+        "QProgressBar {"
+        "   border: 2px solid #555;"
+        "   border-radius: 6px;"
+        "   background-color: #1e1e1e;"
+        "   text-align: center;"
+        "   color: #ffffff;"
+        "   font-size: 12px;"
+        "   min-height: 16px;"
+        "}"
+        "QProgressBar::chunk {"
+        "   background-color: #2196F3;"
+        "   border-radius: 4px;"
+        "}"
+    );
+    levelMeter->hide(); // 录音时显示
+    recordLayout->addWidget(levelMeter);
+    
     // 状态标签
     recordStatusLabel = new QLabel();
     recordStatusLabel->setText("准备录制");
@@ -557,6 +597,8 @@ void RegistrationWidget::setupStep4()
 void RegistrationWidget::startRegistration()
 {
     // 重置所有数据
+    voiceCapture->stop();
+    discardStreamingUpload();
     registrationData = UserRegistrationData();
     currentStep = 0;
     
@@ -590,8 +632,13 @@ void RegistrationWidget::startRegistration()
         recordingProgressBar->setValue(0);
         recordingProgressBar->hide();
     }
+    if (levelMeter) {
+        levelMeter->setValue(0);
+        levelMeter->hide();
+    }
     
     // 加载已有用户（用于关系设置）
+    warmUpServerConnection();
     loadExistingUsers();
     
     // 显示第一步
@@ -654,7 +701,7 @@ void RegistrationWidget::nextStep()
     }
     else if (currentStep == 2) {
         // 验证录音
-        if (registrationData.audioFile.isEmpty() || !QFile::exists(registrationData.audioFile)) {
+        if (!hasRecordedAudio()) {
             QMessageBox::warning(this, "提示", "请完成语音录制");
             return;
         }
@@ -665,7 +712,7 @@ void RegistrationWidget::nextStep()
         currentStep = stackedWidget->count() - 1;
         
         // 显示完成信息
-        QString audioStatus = registrationData.audioFile.isEmpty() ? "未录制" : "已录制";
+        QString audioStatus = hasRecordedAudio() ? "已录制" : "未录制";
         QString infoText = QString(
             "用户信息：\n\n"
             "姓名：%1\n"
@@ -733,7 +780,7 @@ void RegistrationWidget::updateButtonStates()
         canNext = true; // 关系设置是可选的
     }
     else if (currentStep == 2) {
-        canNext = !registrationData.audioFile.isEmpty() && QFile::exists(registrationData.audioFile);
+        canNext = hasRecordedAudio();
     }
     
     // 最后一步：隐藏所有导航按钮
@@ -756,6 +803,7 @@ void RegistrationWidget::startRecording()
     }
     
     recordingInProgress = true;
+    autoStopQueued = false;
     
     // 更新UI
     recordButton->setText("⏹️ 停止录制");
@@ -779,95 +827,228 @@ void RegistrationWidget::startRecording()
     recordStatusLabel->setText("🔴 录制中...");
     recordStatusLabel->setStyleSheet("color: #f44336; font-size: 16px; font-weight: bold;");
     
-    // 显示进度条
+    // 显示进度条和电平表
     recordingProgressBar->show();
     recordingProgressBar->setValue(0);
+    levelMeter->show();
     
-    // 设置录音文件路径
-    QString fileName = QString("user_%1_audio_%2.wav")
-                      .arg(registrationData.userId.isEmpty() ? "temp" : registrationData.userId)
-                      .arg(QDateTime::currentMSecsSinceEpoch());
-    QString filePath = audioOutputDir + "/" + fileName;
-    registrationData.audioFile = filePath;
-    
-    // 初始化录音器（如果需要的话）
-    if (!audioRecorder) {
-        audioRecorder = new QAudioRecorder(this);
-        connect(audioRecorder, &QAudioRecorder::stateChanged, this, &RegistrationWidget::onRecordingFinished);
-    }
-    
-    // 检查支持的编解码器
-    qDebug() << "支持的音频编解码器:" << audioRecorder->supportedAudioCodecs();
-    qDebug() << "支持的容器格式:" << audioRecorder->supportedContainers();
-    
-    // 设置录音参数（使用更兼容的设置）
-    QAudioEncoderSettings audioSettings;
-    
-    // 尝试使用系统支持的编解码器
-    QStringList supportedCodecs = audioRecorder->supportedAudioCodecs();
-    if (supportedCodecs.contains("audio/x-wav")) {
-        audioSettings.setCodec("audio/x-wav");
-    } else if (supportedCodecs.contains("audio/pcm")) {
-        audioSettings.setCodec("audio/pcm");
-    } else if (!supportedCodecs.isEmpty()) {
-        audioSettings.setCodec(supportedCodecs.first());
-        qDebug() << "使用第一个可用编解码器:" << supportedCodecs.first();
-    }
-    
-    audioSettings.setQuality(QMultimedia::NormalQuality); // 降低质量要求
-    audioSettings.setSampleRate(16000);
-    audioSettings.setChannelCount(1);
-    
-    // 设置容器格式
-    QStringList supportedContainers = audioRecorder->supportedContainers();
-    if (supportedContainers.contains("audio/x-wav")) {
-        audioRecorder->setContainerFormat("audio/x-wav");
-    } else if (supportedContainers.contains("wav")) {
-        audioRecorder->setContainerFormat("wav");
-    } else if (!supportedContainers.isEmpty()) {
-        audioRecorder->setContainerFormat(supportedContainers.first());
-        qDebug() << "使用第一个可用容器格式:" << supportedContainers.first();
-    }
-    
-    audioRecorder->setEncodingSettings(audioSettings);
-    
-    qDebug() << "录音设置:";
-    qDebug() << "  - 编解码器:" << audioSettings.codec();
-    qDebug() << "  - 采样率:" << audioSettings.sampleRate();
-    qDebug() << "  - 声道数:" << audioSettings.channelCount();
-    qDebug() << "  - 容器格式:" << audioRecorder->containerFormat();
-    
-    // 开始录音
-    audioRecorder->setOutputLocation(QUrl::fromLocalFile(filePath));
-    qDebug() << "开始录音到:" << filePath;
-    audioRecorder->record();
-    
-    // 检查录音状态
-    QTimer::singleShot(500, [this]() {
-        qDebug() << "录音状态检查:";
-        qDebug() << "  - 当前状态:" << audioRecorder->state();
-        qDebug() << "  - 错误信息:" << audioRecorder->errorString();
-        qDebug() << "  - 实际输出位置:" << audioRecorder->actualLocation().toString();
-    });
-    
-    // 启动进度更新定时器
-    QTimer *progressTimer = new QTimer(this);
-    connect(progressTimer, &QTimer::timeout, [this, progressTimer]() {
-        if (!recordingInProgress) {
-            progressTimer->deleteLater();
-            return;
-        }
-        int currentValue = recordingProgressBar->value();
-        if (currentValue < recordingProgressBar->maximum()) {
-            recordingProgressBar->setValue(currentValue + 100); // 每100ms更新一次
-        }
-    });
-    progressTimer->start(100);
+    if (!startCapture()) {
+        recordingInProgress = false;
+        recordButton->setText("🎤 开始录制");
+        recordButton->setStyleSheet(
+            "QPushButton {"
+            "   color: #ffffff;"
+            "   background: #4CAF50;"
+            "   border: 3px solid #4CAF50;"
+            "   border-radius: 12px;"
+            "   padding: 15px 30px;"
+            "   font-size: 20px;"
+            "   font-weight: bold;"
+            "   min-width: 200px;"
+            "   min-height: 60px;"
+            "}"
+        );
+        recordingProgressBar->setValue(0);
+        levelMeter->hide();
+        return;
+    }
     
-    // 启动12秒定时器
+    // 进度与电平随采集数据更新（onAudioLevel），录音时长上限仍由定时器控制
     recordingTimer->start(RECORDING_DURATION_MS);
-    
-    qDebug() << "开始录制音频，文件路径:" << filePath;
+}
+
+bool RegistrationWidget::startCapture()
+{
+    QString error;
+    if (!voiceCapture->start(&error)) {
+        qDebug() << "无法开始录音:" << error;
+        recordStatusLabel->setText("录音失败：" + error);
+        recordStatusLabel->setStyleSheet("color: #f44336; font-size: 16px; font-weight: bold;");
+        return false;
+    }
+    registrationData.audioWav.clear();
+    vad.reset();
+
+    // 重新录制：放弃上一段的流式请求及其结果，新录音重新发起
+    discardStreamingUpload();
+    if (!streamingUploadEnabled) {
+        qDebug() << "开始录音（内存缓冲" << voiceCapture->maxDurationMs() << "ms）";
+        return true;
+    }
+
+    // createTime 随请求开头发出，取开始录音的时间；整段上传回退时沿用同一时间
+    registrationData.registrationTime = QDateTime::currentDateTime();
+    streamingUpload = new ChunkedFormUpload(QUrl(serverBaseUrl + "/registerUser"), this);
+    ChunkedFormUpload::FormFields fields;
+    fields << qMakePair(QStringLiteral("userId"), registrationData.userId)
+           << qMakePair(QStringLiteral("nickname"), registrationData.name)
+           << qMakePair(QStringLiteral("groupId"), GROUP_ID)
+           << qMakePair(QStringLiteral("createTime"), registrationData.registrationTime.toString("yyyy-MM-dd hh:mm:ss"));
+    // 关系设置在录音之前（第1步），随开头字段一起发出，录音结束即可结束请求体
+    streamedRelations = registrationData.relations.isEmpty() ? QString() : relationshipsJson(registrationData.relations);
+    if (!streamedRelations.isEmpty()) {
+        fields << qMakePair(QStringLiteral("relationships"), streamedRelations);
+    }
+    const QString fileName = QString("user_%1_audio.wav").arg(registrationData.userId);
+    // 长度未知，WAV头按流式写法填0xFFFFFFFF；音频数据在检测到开口后由 streamSpeechAudio() 追加
+    streamedBytes = 0;
+    if (!streamingUpload->start(fields, "audio", fileName, "audio/wav", VoiceCapture::wavHeader(0xFFFFFFFFu))) {
+        discardStreamingUpload();
+    } else {
+        connect(streamingUpload, &ChunkedFormUpload::finished, this, &RegistrationWidget::onStreamingUploadFinished);
+        connect(streamingUpload, &ChunkedFormUpload::failed, this, &RegistrationWidget::onStreamingUploadFailed);
+    }
+    qDebug() << "开始采集PCM，边录边传:" << (streamingUpload != nullptr);
+    return true;
+}
+
+void RegistrationWidget::onPcmCaptured(const QByteArray& chunk)
+{
+    // 采集格式为小端16bit，与开发板/PC本机字节序一致，直接按qint16送入检测
+    vad.process(reinterpret_cast<const qint16*>(chunk.constData()), chunk.size() / VoiceCapture::BYTES_PER_SAMPLE);
+    if (streamingUpload && streamingUpload->isOpen()) {
+        streamSpeechAudio();
+    }
+
+    // 说够一段话后停顿即自动结束，不必等满录音时长。
+    // 本函数在VoiceCapture的readyRead处理中被调用，停止采集需回到事件循环后再执行
+    if (recordingInProgress && !autoStopQueued && vad.speechDetected()
+        && vad.speechEndMs() - vad.speechStartMs() >= VAD_MIN_SPEECH_MS
+        && vad.trailingSilenceMs() >= VAD_TRAILING_SILENCE_MS) {
+        qDebug() << "检测到说话结束，自动停止录音";
+        autoStopQueued = true;
+        QMetaObject::invokeMethod(this, "stopRecording", Qt::QueuedConnection);
+    }
+}
+
+void RegistrationWidget::onAudioLevel(float rms, float peak)
+{
+    levelMeter->setValue(qBound(0, qRound((levelToDb(rms) + 60.0f) * 100.0f / 60.0f), 100));
+    levelMeter->setFormat(peak > 0.0f ? QString("峰值 %1 dB").arg(qRound(levelToDb(peak))) : QString("无声"));
+    // 进度按实际采集到的时长推进
+    if (recordingInProgress) {
+        recordingProgressBar->setValue(int(qMin<qint64>(voiceCapture->durationMs(), RECORDING_DURATION_MS)));
+    }
+}
+
+void RegistrationWidget::streamSpeechAudio()
+{
+    if (!vad.speechDetected()) {
+        return;
+    }
+    const qint64 speechFrom = VoiceCapture::bytesForMs(qMax<qint64>(0, vad.speechStartMs() - VAD_PREROLL_MS));
+    const qint64 from = qMax(streamedBytes, speechFrom);
+    // 尾部保留：只发到最后一个语音帧之后 VAD_PREROLL_MS，与整段上传的裁剪一致；
+    // 停顿后继续说话时，留下的静音随后续语音一起发出
+    const qint64 speechTo = VoiceCapture::bytesForMs(vad.speechEndMs() + VAD_PREROLL_MS);
+    const qint64 to = qMin(voiceCapture->capturedBytes(), speechTo);
+    if (to > from) {
+        streamingUpload->appendFileData(voiceCapture->pcm(from, to));
+        streamedBytes = to;
+    }
+}
+
+void RegistrationWidget::releaseStreamingUpload()
+{
+    if (!streamingUpload) {
+        return;
+    }
+    disconnect(streamingUpload, nullptr, this, nullptr);
+    streamingUpload->abort();
+    streamingUpload->deleteLater();
+    streamingUpload = nullptr;
+}
+
+void RegistrationWidget::discardStreamingUpload()
+{
+    releaseStreamingUpload();
+    streamingSubmitPending = false;
+    streamedBodyClosed = false;
+    streamedRelations.clear();
+    streamedResultReady = false;
+    streamedStatus = 0;
+    streamedBody.clear();
+    streamedError.clear();
+}
+
+void RegistrationWidget::finishStreamingUpload()
+{
+    if (!streamingUpload || !streamingUpload->isOpen()) {
+        return;
+    }
+    // 音频与全部字段都已发出：结束请求体，服务端在用户确认之前就开始处理声纹
+    qDebug() << "录音结束，结束流式注册请求体";
+    streamedBodyClosed = true;
+    streamingUpload->finish(ChunkedFormUpload::FormFields());
+}
+
+void RegistrationWidget::onStreamingUploadFinished(int httpStatus, const QByteArray& body)
+{
+    if (!streamedBodyClosed) {
+        // 请求体未结束服务端就已响应（通常是拒绝），提交时改为整段上传
+        qDebug() << "流式上传提前结束，HTTP状态:" << httpStatus << body;
+        discardStreamingUpload();
+        return;
+    }
+    qDebug() << "流式注册完成，HTTP状态:" << httpStatus << "响应数据:" << body;
+    releaseStreamingUpload();
+    streamedResultReady = true;
+    streamedStatus = httpStatus;
+    streamedBody = body;
+    streamedError.clear();
+    // 用户尚未提交时结果先保留，提交时再显示
+    if (streamingSubmitPending) {
+        applyStreamedResult();
+    }
+}
+
+void RegistrationWidget::onStreamingUploadFailed(const QString& error)
+{
+    if (!streamingUpload || !streamingUpload->bodyComplete()) {
+        // 请求体未完整发出，服务端不会处理：提交时改为整段上传
+        const bool submitted = streamingSubmitPending;
+        discardStreamingUpload();
+        qDebug() << "流式上传失败，改为整段上传:" << error;
+        if (submitted) {
+            submitRegistration();
+        }
+        return;
+    }
+    // 请求体已完整发出（如等待响应超时、响应不完整）：服务端可能已注册，注册非幂等，不再重发
+    qDebug() << "流式注册失败，请求可能已送达:" << error;
+    releaseStreamingUpload();
+    streamedResultReady = true;
+    streamedStatus = 0;
+    streamedBody.clear();
+    streamedError = error;
+    if (streamingSubmitPending) {
+        applyStreamedResult();
+    }
+}
+
+void RegistrationWidget::applyStreamedResult()
+{
+    const int httpStatus = streamedStatus;
+    const QByteArray body = streamedBody;
+    const QString error = streamedError;
+    // 结果只使用一次；用户再次提交时按整段上传处理
+    discardStreamingUpload();
+    if (error.isEmpty() && (httpStatus == 502 || httpStatus == 503)) {
+        // 网关繁忙，请求未被处理：与整段上传的重试规则一致，改为整段上传
+        submitRegistration();
+        return;
+    }
+    showLoadingState(false);
+    if (!error.isEmpty()) {
+        showNetworkError("注册请求失败：" + error);
+        return;
+    }
+    if (httpStatus < 200 || httpStatus >= 500) {
+        showNetworkError(QString("注册请求失败：HTTP %1").arg(httpStatus));
+        return;
+    }
+    // 2xx/4xx：业务状态码在JSON中，交给解析函数处理
+    parseRegistrationResponse(body);
 }
 
 void RegistrationWidget::stopRecording()
@@ -877,10 +1058,19 @@ void RegistrationWidget::stopRecording()
     }
     
     recordingInProgress = false;
+    autoStopQueued = false;
     recordingTimer->stop();
     
-    if (audioRecorder && audioRecorder->state() == QMediaRecorder::RecordingState) {
-        audioRecorder->stop();
+    voiceCapture->stop();
+    qDebug() << "录音完成，时长:" << voiceCapture->durationMs() << "ms";
+    if (streamingUpload && !vad.speechDetected()) {
+        // 未检测到语音，流式请求中没有音频，提交时改为整段上传
+        discardStreamingUpload();
+    }
+    if (streamingUpload && streamingUpload->isOpen()) {
+        // 补发最后一段语音（到语音结束后 VAD_PREROLL_MS 为止），尾部静音不上传；
+        // 录音通过校验后在下面结束请求体
+        streamSpeechAudio();
     }
     
     // 更新UI
@@ -903,41 +1093,48 @@ void RegistrationWidget::stopRecording()
         "}"
     );
     
-    // 验证文件是否存在
-    QString filePath = registrationData.audioFile;
-    qDebug() << "录制完成，检查文件:" << filePath;
-    
-    if (QFile::exists(filePath)) {
-        QFileInfo fileInfo(filePath);
-        qDebug() << "音频文件大小:" << fileInfo.size() << "字节";
-        
-        if (fileInfo.size() > 0) {
-            recordStatusLabel->setText("✅ 录制完成");
-            recordStatusLabel->setStyleSheet("color: #4CAF50; font-size: 16px; font-weight: bold;");
-            recordingProgressBar->setValue(recordingProgressBar->maximum());
-            recordingInstructionLabel->setText("录制成功！您可以重新录制或继续下一步。");
-        } else {
-            recordStatusLabel->setText("录音文件为空，请重新录制");
-            recordStatusLabel->setStyleSheet("color: #f44336; font-size: 16px; font-weight: bold;");
-            recordingProgressBar->setValue(0);
-            registrationData.audioFile = "";
-        }
+    // 录音期间连接可能已被服务端回收，提前重连，提交注册时直接复用
+    warmUpServerConnection();
+
+    levelMeter->hide();
+
+    // 验证录音：WAV头和数据都在内存中生成；几乎无声或没有语音的录音直接要求重录，不浪费一次上传。
+    // 单次咳嗽、碰麦等短促声音峰值够高，但检测不到语音、整段均方根也很低
+    const float takePeakDb = levelToDb(voiceCapture->takePeak());
+    const float takeRmsDb = levelToDb(voiceCapture->takeRms());
+    qDebug() << "录音电平: 峰值" << takePeakDb << "dBFS, 均方根" << takeRmsDb << "dBFS, 检测到语音:" << vad.speechDetected();
+    if (voiceCapture->durationMs() > 0
+        && (takePeakDb < MIN_TAKE_PEAK_DBFS || takeRmsDb < MIN_TAKE_RMS_DBFS || !vad.speechDetected())) {
+        recordStatusLabel->setText(takePeakDb < MIN_TAKE_PEAK_DBFS || takeRmsDb < MIN_TAKE_RMS_DBFS
+                                   ? "声音太小，请靠近麦克风重新录制" : "未检测到说话，请重新录制");
+        recordStatusLabel->setStyleSheet("color: #f44336; font-size: 16px; font-weight: bold;");
+        recordingProgressBar->setValue(0);
+        registrationData.audioWav.clear();
+        discardStreamingUpload();
+    } else if (voiceCapture->durationMs() > 0) {
+        // 裁掉语音前后的静音，前后各保留 VAD_PREROLL_MS
+        const qint64 from = VoiceCapture::bytesForMs(qMax<qint64>(0, vad.speechStartMs() - VAD_PREROLL_MS));
+        const qint64 to = VoiceCapture::bytesForMs(vad.speechEndMs() + VAD_PREROLL_MS);
+        registrationData.audioWav = voiceCapture->wav(from, to);
+        qDebug() << "语音区间:" << vad.speechStartMs() << "-" << vad.speechEndMs() << "ms，裁剪后"
+                 << registrationData.audioWav.size() << "字节";
+        finishStreamingUpload();
+        recordStatusLabel->setText("✅ 录制完成");
+        recordStatusLabel->setStyleSheet("color: #4CAF50; font-size: 16px; font-weight: bold;");
+        recordingProgressBar->setValue(recordingProgressBar->maximum());
+        recordingInstructionLabel->setText("录制成功！您可以重新录制或继续下一步。");
     } else {
-        qDebug() << "警告：录音文件不存在，可能录音失败";
-        recordStatusLabel->setText("录音失败，请重新录制");
+        qDebug() << "警告：没有采集到音频数据";
+        recordStatusLabel->setText("录音为空，请重新录制");
         recordStatusLabel->setStyleSheet("color: #f44336; font-size: 16px; font-weight: bold;");
         recordingProgressBar->setValue(0);
-        registrationData.audioFile = "";
+        registrationData.audioWav.clear();
+        discardStreamingUpload();
     }
     
     updateButtonStates();
 }
 
-void RegistrationWidget::onRecordingFinished()
-{
-    // 录音状态改变的处理
-}
-
 void RegistrationWidget::loadExistingUsers()
 {
     // 清空现有用户列表
@@ -1242,7 +1439,10 @@ void RegistrationWidget::skipRelations()
 
 void RegistrationWidget::finishRegistration()
 {
-    registrationData.registrationTime = QDateTime::currentDateTime();
+    // 流式请求已带出 createTime（开始录音的时间）时沿用，整段回退与流式请求使用同一时间
+    if (!streamingUpload && !streamedBodyClosed) {
+        registrationData.registrationTime = QDateTime::currentDateTime();
+    }
     
     // 显示加载状态
     showLoadingState(true);
@@ -1260,105 +1460,195 @@ void RegistrationWidget::returnToInterface()
 
 void RegistrationWidget::fetchRegisteredUsers()
 {
-    qDebug() << "Qt网络模块不可用，使用curl命令替代...";
-    
-    // 使用curl命令获取用户列表
-    QString url = serverBaseUrl + "/getRegisteredUsers?groupId=" + GROUP_ID;
-    
-    QProcess *curlProcess = new QProcess(this);
-    QStringList arguments;
-    arguments << "-s" << "-X" << "GET" << url;
-    
-    connect(curlProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [this, curlProcess](int exitCode, QProcess::ExitStatus exitStatus) {
-                if (exitCode == 0) {
-                    QByteArray responseData = curlProcess->readAllStandardOutput();
-                    qDebug() << "curl获取成功，响应数据:" << responseData;
-                    parseFetchUsersResponse(responseData);
-                } else {
-                    QByteArray errorData = curlProcess->readAllStandardError();
-                    qDebug() << "curl获取失败:" << errorData;
-                    showNetworkError("网络请求失败：" + QString::fromUtf8(errorData));
-                }
-                curlProcess->deleteLater();
-                showLoadingState(false);
-            });
-    
+    QUrl url(serverBaseUrl + "/getRegisteredUsers");
+    QUrlQuery query;
+    query.addQueryItem("groupId", GROUP_ID);
+    url.setQuery(query);
+
     showLoadingState(true);
-    qDebug() << "使用curl请求:" << url;
-    curlProcess->start("curl", arguments);
+    qDebug() << "获取用户列表:" << url.toString();
+    sendRequest(QStringLiteral("获取用户列表"), true, REQUEST_TIMEOUT_MS,
+                [this, url]() { return networkManager->get(QNetworkRequest(url)); },
+                [this](const QByteArray& responseData) {
+                    qDebug() << "获取成功，响应数据:" << responseData;
+                    parseFetchUsersResponse(responseData);
+                });
 }
 
 void RegistrationWidget::submitRegistration()
 {
-    qDebug() << "使用curl进行用户注册...";
-    
-    // 检查音频文件
-    if (registrationData.audioFile.isEmpty()) {
-        showNetworkError("没有录制音频文件");
+    // 已在等待流式请求的结果：不再重复提交
+    if (streamingSubmitPending) {
         return;
     }
-    
-    QFile audioFile(registrationData.audioFile);
-    if (!audioFile.exists()) {
-        qDebug() << "音频文件不存在:" << registrationData.audioFile;
-        showNetworkError("音频文件不存在");
-        return;
+    // 录音结束时已结束请求体：关系未改动则直接使用（或等待）其结果
+    if (streamedBodyClosed) {
+        const QString relations = registrationData.relations.isEmpty() ? QString() : relationshipsJson(registrationData.relations);
+        if (relations == streamedRelations) {
+            showLoadingState(true);
+            if (streamedResultReady) {
+                applyStreamedResult();
+            } else {
+                qDebug() << "等待流式注册结果";
+                streamingSubmitPending = true;
+            }
+            return;
+        }
+        // 录音后又修改了关系：放弃流式请求，按当前关系整段重新提交
+        qDebug() << "录音后关系已修改，改为整段上传";
+        discardStreamingUpload();
     }
-    
-    if (audioFile.size() == 0) {
-        qDebug() << "音频文件为空:" << registrationData.audioFile;
-        showNetworkError("音频文件为空");
+    // 仍在录音中的流式请求不会被服务端处理，放弃后整段上传
+    discardStreamingUpload();
+
+    if (registrationData.audioWav.isEmpty()) {
+        showNetworkError("没有录制音频");
         return;
     }
-    
-    // 构建curl命令
-    QString url = serverBaseUrl + "/registerUser";
-    
-    QProcess *curlProcess = new QProcess(this);
-    QStringList arguments;
-    arguments << "-s" << "-X" << "POST";
-    arguments << "-F" << QString("userId=%1").arg(registrationData.userId);
-    arguments << "-F" << QString("nickname=%1").arg(registrationData.name);
-    arguments << "-F" << QString("groupId=%1").arg(GROUP_ID);
-    arguments << "-F" << QString("createTime=%1").arg(registrationData.registrationTime.toString("yyyy-MM-dd hh:mm:ss"));
-    
-    // 添加关系数据
-    if (!registrationData.relations.isEmpty()) {
-        QJsonArray relationArray;
-        for (const RelationData &relation : registrationData.relations) {
-            QJsonObject relationObj;
-            relationObj["userId"] = relation.objectUserId;
-            relationObj["relation"] = relation.relationType;
-            relationArray.append(relationObj);
+
+    const QUrl url(serverBaseUrl + "/registerUser");
+    const UserRegistrationData data = registrationData;
+
+    // 每次尝试重新构造multipart；WAV在内存中，各次尝试共享同一份数据（隐式共享，不复制）
+    auto buildRequest = [this, url, data]() -> QNetworkReply* {
+        QHttpMultiPart *multi = new QHttpMultiPart(QHttpMultiPart::FormDataType);
+        auto addField = [multi](const QString& name, const QString& value) {
+            QHttpPart part;
+            part.setHeader(QNetworkRequest::ContentDispositionHeader,
+                           QVariant(QString("form-data; name=\"%1\"").arg(name)));
+            part.setBody(value.toUtf8());
+            multi->append(part);
+        };
+        addField("userId", data.userId);
+        addField("nickname", data.name);
+        addField("groupId", GROUP_ID);
+        addField("createTime", data.registrationTime.toString("yyyy-MM-dd hh:mm:ss"));
+
+        // 添加关系数据
+        if (!data.relations.isEmpty()) {
+            addField("relationships", relationshipsJson(data.relations));
         }
-        QJsonDocument relationDoc(relationArray);
-        arguments << "-F" << QString("relationships=%1").arg(QString::fromUtf8(relationDoc.toJson(QJsonDocument::Compact)));
-    }
-    
-    // 添加音频文件
-    arguments << "-F" << QString("audio=@%1").arg(registrationData.audioFile);
-    arguments << url;
-    
-    connect(curlProcess, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
-            [this, curlProcess](int exitCode, QProcess::ExitStatus exitStatus) {
-                if (exitCode == 0) {
-                    QByteArray responseData = curlProcess->readAllStandardOutput();
-                    qDebug() << "curl注册成功，响应数据:" << responseData;
+
+        // 添加音频
+        QHttpPart audioPart;
+        audioPart.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("audio/wav"));
+        audioPart.setHeader(QNetworkRequest::ContentDispositionHeader,
+                            QVariant(QString("form-data; name=\"audio\"; filename=\"user_%1_audio.wav\"").arg(data.userId)));
+        audioPart.setBody(data.audioWav);
+        multi->append(audioPart);
+
+        QNetworkReply *reply = networkManager->post(QNetworkRequest(url), multi);
+        multi->setParent(reply); // reply完成后释放
+        return reply;
+    };
+
+    showLoadingState(true);
+    qDebug() << "注册用户:" << url.toString();
+    qDebug() << "音频大小:" << data.audioWav.size() << "字节";
+    // 注册非幂等：只在请求确定未送达服务端时重试
+    sendRequest(QStringLiteral("注册请求"), false, UPLOAD_TIMEOUT_MS, buildRequest,
+                [this](const QByteArray& responseData) {
+                    qDebug() << "注册请求完成，响应数据:" << responseData;
                     parseRegistrationResponse(responseData);
-                } else {
-                    QByteArray errorData = curlProcess->readAllStandardError();
-                    qDebug() << "curl注册失败:" << errorData;
-                    showNetworkError("注册请求失败：" + QString::fromUtf8(errorData));
-                }
-                curlProcess->deleteLater();
-                showLoadingState(false);
+                });
+}
+
+QString RegistrationWidget::relationshipsJson(const QList<RelationData>& relations)
+{
+    QJsonArray relationArray;
+    for (const RelationData &relation : relations) {
+        QJsonObject relationObj;
+        relationObj["userId"] = relation.objectUserId;
+        relationObj["relation"] = relation.relationType;
+        relationArray.append(relationObj);
+    }
+    return QString::fromUtf8(QJsonDocument(relationArray).toJson(QJsonDocument::Compact));
+}
+
+void RegistrationWidget::warmUpServerConnection()
+{
+    // 预先建立到注册服务器的keep-alive连接，获取用户列表与提交注册都复用它
+    const QUrl url(serverBaseUrl);
+    networkManager->connectToHost(url.host(), quint16(url.port(80)));
+}
+
+static bool isRetryableNetworkError(QNetworkReply::NetworkError error, bool idempotent)
+{
+    switch (error) {
+    // 连接尚未建立，请求一定没有到达服务端
+    case QNetworkReply::ConnectionRefusedError:
+    case QNetworkReply::HostNotFoundError:
+    case QNetworkReply::TemporaryNetworkFailureError:
+    case QNetworkReply::NetworkSessionFailedError:
+        return true;
+    // 请求可能已被处理，只对幂等请求重试
+    case QNetworkReply::RemoteHostClosedError:
+    case QNetworkReply::TimeoutError:
+    case QNetworkReply::OperationCanceledError: // 由超时定时器中止
+    case QNetworkReply::UnknownNetworkError:
+        return idempotent;
+    default:
+        return false;
+    }
+}
+
+void RegistrationWidget::sendRequest(const QString& what, bool idempotent, int timeoutMs,
+                                     const std::function<QNetworkReply*()>& buildRequest,
+                                     const std::function<void(const QByteArray&)>& onResponse,
+                                     int attempt)
+{
+    QNetworkReply *reply = buildRequest();
+    if (!reply) {
+        showLoadingState(false);
+        showNetworkError(what + "失败：无法构造请求");
+        return;
+    }
+    currentReply = reply;
+
+    // 无数据进出超过timeoutMs才判定超时；上传/下载有进度就重新计时
+    QTimer *timeout = new QTimer(reply);
+    timeout->setSingleShot(true);
+    timeout->setInterval(timeoutMs);
+    connect(timeout, &QTimer::timeout, reply, [reply]() {
+        reply->setProperty("timedOut", true);
+        reply->abort();
+    });
+    connect(reply, &QNetworkReply::uploadProgress, timeout, [timeout]() { timeout->start(); });
+    connect(reply, &QNetworkReply::downloadProgress, timeout, [timeout]() { timeout->start(); });
+    timeout->start();
+
+    connect(reply, &QNetworkReply::finished, this, [=]() {
+        reply->deleteLater();
+        if (currentReply == reply) {
+            currentReply = nullptr;
+        }
+        const QNetworkReply::NetworkError error = reply->error();
+        const bool timedOut = reply->property("timedOut").toBool();
+        if (error == QNetworkReply::OperationCanceledError && !timedOut) {
+            return; // 主动取消（如控件析构）
+        }
+
+        const int httpStatus = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
+        const bool gatewayBusy = (httpStatus == 502 || httpStatus == 503);
+        const bool retryable = httpStatus == 0 ? isRetryableNetworkError(error, idempotent) : gatewayBusy;
+        if (error != QNetworkReply::NoError && retryable && attempt < REQUEST_MAX_RETRIES) {
+            const int delayMs = REQUEST_RETRY_BASE_MS << attempt;
+            qDebug() << what << "失败，" << delayMs << "ms后重试:" << (timedOut ? QStringLiteral("超时") : reply->errorString());
+            QTimer::singleShot(delayMs, this, [=]() {
+                sendRequest(what, idempotent, timeoutMs, buildRequest, onResponse, attempt + 1);
             });
-    
-    showLoadingState(true);
-    qDebug() << "使用curl注册用户:" << url;
-    qDebug() << "音频文件:" << registrationData.audioFile;
-    curlProcess->start("curl", arguments);
+            return;
+        }
+
+        showLoadingState(false);
+        if (httpStatus != 0) {
+            // 收到HTTP响应：业务状态码在JSON中，与curl一样交给解析函数处理（含4xx）
+            onResponse(reply->readAll());
+            return;
+        }
+        qDebug() << what << "失败:" << error << reply->errorString();
+        showNetworkError(what + "失败：" + (timedOut ? QStringLiteral("请求超时") : reply->errorString()));
+    });
 }
 
 void RegistrationWidget::onGetUsersFinished()
@@ -1476,7 +1766,7 @@ void RegistrationWidget::onRegisterUserFinished()
         // 完全成功
         qDebug() << "用户注册完全成功:" << message;
         QMessageBox::information(this, "注册成功", "用户注册成功！\n声纹识别也已成功注册。");
-        cleanupAudioFile(); // 清理音频文件
+        registrationData.audioWav.clear(); // 释放录音数据
         emit registrationCompleted(registrationData);
     } else if (code == 207) {
         // 部分成功
@@ -1490,7 +1780,7 @@ void RegistrationWidget::onRegisterUserFinished()
         detailMessage += "您可以稍后重新录制声纹。";
         
         QMessageBox::warning(this, "注册部分成功", detailMessage);
-        cleanupAudioFile(); // 清理音频文件
+        registrationData.audioWav.clear(); // 释放录音数据
         emit registrationCompleted(registrationData);
     } else if (code == 409) {
         // 用户ID冲突
@@ -1796,59 +2086,9 @@ void RegistrationWidget::updateUserListUI()
     usersLayout->addStretch();
 }
 
-void RegistrationWidget::cleanupAudioFile()
+bool RegistrationWidget::hasRecordedAudio() const
 {
-    if (registrationData.audioFile.isEmpty()) {
-        return;
-    }
-    
-    QString filePath = registrationData.audioFile;
-    registrationData.audioFile.clear(); // 先清空记录，避免重复尝试
-    
-    if (!QFile::exists(filePath)) {
-        qDebug() << "音频文件不存在，无需删除:" << filePath;
-        return;
-    }
-    
-    // 确保音频录制器已经停止并释放文件
-    if (audioRecorder && audioRecorder->state() != QMediaRecorder::StoppedState) {
-        audioRecorder->stop();
-        QTimer::singleShot(100, [this, filePath]() {
-            deleteAudioFileWithRetry(filePath, 3);
-        });
-    } else {
-        deleteAudioFileWithRetry(filePath, 3);
-    }
-}
-
-void RegistrationWidget::deleteAudioFileWithRetry(const QString& filePath, int retryCount)
-{
-    QFile file(filePath);
-    
-    // 尝试设置文件为可写（有时文件可能是只读状态）
-    file.setPermissions(QFile::WriteOwner | QFile::ReadOwner);
-    
-    if (file.remove()) {
-        qDebug() << "成功删除音频文件:" << filePath;
-        return;
-    }
-    
-    if (retryCount > 0) {
-        qDebug() << "删除音频文件失败，剩余重试次数:" << retryCount << "文件:" << filePath;
-        // 等待100ms后重试
-        QTimer::singleShot(100, [this, filePath, retryCount]() {
-            deleteAudioFileWithRetry(filePath, retryCount - 1);
-        });
-    } else {
-        qDebug() << "删除音频文件最终失败:" << filePath;
-        qDebug() << "文件错误:" << file.errorString();
-        
-        // 如果删除失败，尝试标记文件为临时文件（系统重启时会清理）
-        QString tempPath = filePath + ".tmp";
-        if (file.rename(tempPath)) {
-            qDebug() << "将文件重命名为临时文件:" << tempPath;
-        }
-    }
+    return !registrationData.audioWav.isEmpty();
 }
 
 void RegistrationWidget::testBasicNetworkConnection()
@@ -1959,11 +2199,11 @@ void RegistrationWidget::parseRegistrationResponse(const QByteArray& responseDat
     
     if (code == 200) {
         qDebug() << "用户注册成功";
-        cleanupAudioFile(); // 删除临时音频文件
+        registrationData.audioWav.clear(); // 释放录音数据
         nextStep(); // 进入完成页面
     } else if (code == 207) {
         qDebug() << "部分注册成功:" << message;
-        cleanupAudioFile();
+        registrationData.audioWav.clear();
         nextStep();
     } else if (code == 409) {
         qDebug() << "用户ID冲突:" << message;
@@ -16,12 +16,7 @@
 #include <QDateTime>
 #include <QScrollArea>
 #include <QCheckBox>
-#include <QAudioRecorder>
-#include <QAudioEncoderSettings>
 #include <QUrl>
-#include <QDir>
-#include <QStandardPaths>
-#include <QMediaRecorder>
 #include <QMessageBox>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
@@ -33,7 +28,10 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QNetworkProxy>
-#include <QProcess>
+#include <functional>
+#include "voicecapture.h"
+#include "voiceactivitydetector.h"
+#include "chunkedformupload.h"
 
 struct UserData {
     QString name;
@@ -52,7 +50,7 @@ struct RelationData {
 struct UserRegistrationData {
     QString name;                    // 姓名
     QString userId;                  // X16BAC + 13位时间戳
-    QString audioFile;               // 单段录音文件路径（10-15秒）
+    QByteArray audioWav;             // 单段录音（10-15秒），16kHz单声道WAV，仅在内存中
     QList<RelationData> relations;   // 家庭关系列表
     QDateTime registrationTime;      // 注册时间
 };
@@ -78,7 +76,6 @@ private slots:
     void previousStep();
     void startRecording();
     void stopRecording();
-    void onRecordingFinished();
     void finishRegistration();
     void validateNameInput();
     void addRelation();
@@ -89,6 +86,10 @@ private slots:
     void onGetUsersFinished();
     void onRegisterUserFinished();
     void onNetworkError(QNetworkReply::NetworkError error);
+    void onPcmCaptured(const QByteArray& chunk);
+    void onAudioLevel(float rms, float peak);
+    void onStreamingUploadFinished(int httpStatus, const QByteArray& body);
+    void onStreamingUploadFailed(const QString& error);
     
 private:
     void setupUI();
@@ -105,14 +106,32 @@ private:
     // 网络请求方法
     void fetchRegisteredUsers();
     void submitRegistration();
+    static QString relationshipsJson(const QList<RelationData>& relations);
     void showNetworkError(const QString& message);
     void showLoadingState(bool loading);
     void updateUserListUI();
-    void cleanupAudioFile();
-    void deleteAudioFileWithRetry(const QString& filePath, int retryCount);
     void testBasicNetworkConnection();
     void parseFetchUsersResponse(const QByteArray& responseData);
     void parseRegistrationResponse(const QByteArray& responseData);
+    void warmUpServerConnection();
+    // 开始采集PCM到内存；启用边录边传时同时以chunked请求上传。录音设备不可用时返回false
+    bool startCapture();
+    // 放弃本段录音的流式请求及其结果
+    void discardStreamingUpload();
+    // 只释放连接对象，保留已收到的结果
+    void releaseStreamingUpload();
+    // 录音通过校验后结束流式请求体，服务端随即开始处理
+    void finishStreamingUpload();
+    // 用户提交时处理流式请求的结果
+    void applyStreamedResult();
+    // 流式上传只发送开口之后（含前导）的音频
+    void streamSpeechAudio();
+    bool hasRecordedAudio() const;
+    // 进程内HTTP：超时（无进度计时）+ 指数退避重试；buildRequest 每次尝试重新构造请求
+    void sendRequest(const QString& what, bool idempotent, int timeoutMs,
+                     const std::function<QNetworkReply*()>& buildRequest,
+                     const std::function<void(const QByteArray&)>& onResponse,
+                     int attempt = 0);
     
 protected:
     // 重写鼠标事件，阻止事件传播到父控件
@@ -135,9 +154,12 @@ protected:
     QPushButton *recordButton;
     QLabel *recordStatusLabel;
     QProgressBar *recordingProgressBar;
+    QProgressBar *levelMeter;        // 实时输入电平
     QTimer *recordingTimer;
-    QAudioRecorder *audioRecorder;
+    VoiceCapture *voiceCapture;
+    VoiceActivityDetector vad;
     bool recordingInProgress;
+    bool autoStopQueued;             // 自动停止已排队，等待事件循环执行
     QString recordingText;
     
     // Step 3: 关系设置
@@ -158,16 +180,36 @@ protected:
     UserRegistrationData registrationData;
     QStringList relationOptions;
     int currentStep;
-    QString audioOutputDir;
     
     // 网络相关成员
     QNetworkAccessManager *networkManager;
     QNetworkReply *currentReply;
     QString serverBaseUrl;
     
+    // 边录边传（环境变量 REG_STREAMING_UPLOAD=1 启用）
+    ChunkedFormUpload *streamingUpload;
+    bool streamingUploadEnabled;
+    bool streamingSubmitPending;     // 用户已提交，等待流式请求的结果
+    qint64 streamedBytes;            // 已上传到的采集偏移
+    bool streamedBodyClosed;         // 本段录音的流式请求体已结束（请求已交给服务端）
+    QString streamedRelations;       // 随流式请求发出的relationships，提交时不一致则整段重新提交
+    bool streamedResultReady;        // 流式请求已有结果（响应或请求体发出后的失败）
+    int streamedStatus;
+    QByteArray streamedBody;
+    QString streamedError;
+    
     // 常量
     static const QString GROUP_ID;
     static const int RECORDING_DURATION_MS = 12000; // 12秒
+    static const int REQUEST_TIMEOUT_MS = 10000;    // 普通请求无进度超时
+    static const int UPLOAD_TIMEOUT_MS = 30000;     // 上传音频无进度超时
+    static const int REQUEST_MAX_RETRIES = 2;
+    static const int REQUEST_RETRY_BASE_MS = 500;   // 重试间隔 500ms、1000ms
+    static const int VAD_TRAILING_SILENCE_MS = 1500; // 说话后静音超过该时长自动停止
+    static const int VAD_MIN_SPEECH_MS = 6000;      // 有效语音不足该时长时不自动停止（声纹注册需要足够语音）
+    static const int VAD_PREROLL_MS = 300;          // 裁剪/流式上传时在语音前后保留的余量
+    static const int MIN_TAKE_PEAK_DBFS = -30;      // 整段峰值低于该电平视为几乎无声，不上传
+    static const int MIN_TAKE_RMS_DBFS = -50;       // 整段均方根低于该电平视为只有零星噪声，不上传
 };
 
 #endif // REGISTRATIONWIDGET_H
@@ -0,0 +1,439 @@
+#include "socketserverworker.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QNetworkInterface>
+#include <QHostAddress>
+#include <QCborValue>
+#include <QCborMap>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+namespace {
+inline bool isJsonSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+enum class PeekResult {
+    Found,      // 顶层对象中有该键，value为原始值视图（非字符串值时为空）
+    Absent,     // 顶层对象中确定没有该键
+    Ambiguous   // 键或值含转义等无法按原始字节判断的情况，需完整解析
+};
+
+// 跳过从 p（指向开头引号）起的JSON字符串，返回结束引号之后的位置；hasEscape 报告其中是否有转义
+const char *skipJsonString(const char *p, const char *end, bool *hasEscape)
+{
+    *hasEscape = false;
+    ++p;
+    while (p < end) {
+        if (*p == '\\') {
+            *hasEscape = true;
+            p += 2;
+            continue;
+        }
+        if (*p == '"') {
+            return p + 1;
+        }
+        ++p;
+    }
+    return end;
+}
+
+// 只扫描顶层对象的键，查找 "key": "value" 并返回value视图（不解码转义）。
+// 嵌套对象/数组和字符串内容中的同名文本都不会误匹配
+PeekResult peekJsonStringField(const char *begin, const char *end, const char *key, QLatin1String *value)
+{
+    const size_t keyLength = std::strlen(key);
+    const char *p = begin;
+    while (p < end && isJsonSpace(*p)) ++p;
+    if (p >= end || *p != '{') {
+        return PeekResult::Ambiguous;
+    }
+    ++p;
+    int depth = 1;
+    bool keyExpected = true;
+    while (p < end && depth > 0) {
+        const char c = *p;
+        if (c == '"') {
+            bool hasEscape = false;
+            const char *stringEnd = skipJsonString(p, end, &hasEscape);
+            if (depth == 1 && keyExpected) {
+                keyExpected = false;
+                if (hasEscape) {
+                    return PeekResult::Ambiguous; // 转义写法的键可能就是要找的键
+                }
+                const char *name = p + 1;
+                const size_t nameLength = size_t(stringEnd - name - 1);
+                p = stringEnd;
+                if (nameLength != keyLength || std::memcmp(name, key, keyLength) != 0) {
+                    continue;
+                }
+                while (p < end && isJsonSpace(*p)) ++p;
+                if (p >= end || *p != ':') {
+                    return PeekResult::Ambiguous;
+                }
+                ++p;
+                while (p < end && isJsonSpace(*p)) ++p;
+                if (p >= end || *p != '"') {
+                    *value = QLatin1String();
+                    return PeekResult::Found;
+                }
+                const char *valueEnd = skipJsonString(p, end, &hasEscape);
+                if (hasEscape || valueEnd > end || *(valueEnd - 1) != '"' || valueEnd == p + 1) {
+                    return PeekResult::Ambiguous;
+                }
+                *value = QLatin1String(p + 1, int(valueEnd - p - 2));
+                return PeekResult::Found;
+            }
+            p = stringEnd;
+            continue;
+        }
+        if (c == '{' || c == '[') {
+            ++depth;
+        } else if (c == '}' || c == ']') {
+            --depth;
+        } else if (c == ',' && depth == 1) {
+            keyExpected = true;
+        }
+        ++p;
+    }
+    return PeekResult::Absent;
+}
+}
+
+SocketServerWorker::SocketServerWorker(quint16 port, LlmIngestQueue *ingest, QObject *parent)
+    : QObject(parent)
+    , tcpServer(nullptr)
+    , maxLineBytes(64 * 1024)
+    , ingestQueue(ingest)
+    , readPaused(false)
+    , serverPort(port)
+    , isServerRunning(false)
+{
+}
+
+SocketServerWorker::~SocketServerWorker()
+{
+    stop();
+}
+
+void SocketServerWorker::start()
+{
+    if (isServerRunning) {
+        qDebug() << "[Socket服务器] 服务器已在运行，端口:" << serverPort;
+        return;
+    }
+
+    // 在工作线程中创建，保证服务器及其派生的socket都归属网络线程
+    if (!tcpServer) {
+        tcpServer = new QTcpServer(this);
+        connect(tcpServer, &QTcpServer::newConnection, this, &SocketServerWorker::onNewConnection);
+    }
+
+    if (tcpServer->listen(QHostAddress::Any, serverPort)) {
+        isServerRunning = true;
+        QString localIP = getLocalIPAddress();
+        qDebug() << "[Socket服务器] 启动成功";
+        qDebug() << "[Socket服务器] 监听地址:" << localIP << ":" << serverPort;
+        qDebug() << "[Socket服务器] Python客户端可连接到:" << localIP << ":" << serverPort;
+    } else {
+        qDebug() << "[Socket服务器] 启动失败:" << tcpServer->errorString();
+        isServerRunning = false;
+    }
+    emit serverStateChanged(isServerRunning, serverPort);
+}
+
+void SocketServerWorker::stop()
+{
+    if (!isServerRunning) {
+        return;
+    }
+
+    // 断开所有客户端连接
+    for (QTcpSocket* socket : clientSockets) {
+        disconnect(socket, nullptr, this, nullptr);
+        socket->disconnectFromHost();
+        socket->deleteLater();
+    }
+    clientSockets.clear();
+    clientBuffers.clear();
+
+    // 停止服务器监听
+    tcpServer->close();
+    isServerRunning = false;
+
+    qDebug() << "[Socket服务器] 已停止";
+    emit serverStateChanged(false, serverPort);
+}
+
+void SocketServerWorker::onNewConnection()
+{
+    while (tcpServer->hasPendingConnections()) {
+        QTcpSocket* clientSocket = tcpServer->nextPendingConnection();
+        clientSockets.append(clientSocket);
+        // 限制用户态读缓冲，背压期间内存不会随对端发送无限增长
+        clientSocket->setReadBufferSize(maxLineBytes);
+
+        // 连接客户端信号
+        connect(clientSocket, &QTcpSocket::readyRead, this, &SocketServerWorker::onDataReceived);
+        connect(clientSocket, &QTcpSocket::disconnected, this, &SocketServerWorker::onClientDisconnected);
+        connect(clientSocket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error),
+                this, &SocketServerWorker::onSocketError);
+
+        QString clientIP = clientSocket->peerAddress().toString();
+        quint16 clientPort = clientSocket->peerPort();
+
+        qDebug() << "[Socket服务器] 新客户端连接:" << clientIP << ":" << clientPort;
+        qDebug() << "[Socket服务器] 当前连接数:" << clientSockets.size();
+    }
+}
+
+void SocketServerWorker::onClientDisconnected()
+{
+    QTcpSocket* clientSocket = qobject_cast<QTcpSocket*>(sender());
+    if (clientSocket) {
+        QString clientIP = clientSocket->peerAddress().toString();
+        quint16 clientPort = clientSocket->peerPort();
+
+        // 读出断开前残留的数据（背压暂停期间可能未读），再按完整帧处理最后一行
+        readClient(clientSocket);
+        const ClientBuffer client = clientBuffers.take(clientSocket);
+        if (client.mode == ClientBuffer::Mode::Ndjson && !client.discarding && !client.pending.trimmed().isEmpty()) {
+            processSocketData(client.pending);
+        }
+
+        clientSockets.removeAll(clientSocket);
+        clientSocket->deleteLater();
+
+        qDebug() << "[Socket服务器] 客户端断开连接:" << clientIP << ":" << clientPort;
+        qDebug() << "[Socket服务器] 当前连接数:" << clientSockets.size();
+    }
+}
+
+void SocketServerWorker::onDataReceived()
+{
+    QTcpSocket* clientSocket = qobject_cast<QTcpSocket*>(sender());
+    if (!clientSocket || readPaused) {
+        return;
+    }
+    readClient(clientSocket);
+}
+
+void SocketServerWorker::setReadPaused(bool paused)
+{
+    if (readPaused == paused) {
+        return;
+    }
+    readPaused = paused;
+    qDebug() << "[Socket服务器]" << (paused ? "背压：暂停读取" : "背压解除：恢复读取");
+    if (!paused) {
+        // 暂停期间到达的数据不会再触发readyRead，恢复时主动读取
+        const QList<QTcpSocket*> sockets = clientSockets;
+        for (QTcpSocket* socket : sockets) {
+            if (socket->bytesAvailable() > 0) {
+                readClient(socket);
+            }
+        }
+    }
+}
+
+void SocketServerWorker::readClient(QTcpSocket *clientSocket)
+{
+    if (clientSocket->bytesAvailable() <= 0) {
+        return;
+    }
+    ClientBuffer& client = clientBuffers[clientSocket];
+    const QByteArray data = clientSocket->readAll();
+    client.pending.append(data);
+
+    qDebug() << "[Socket服务器] 收到数据来自" << clientSocket->peerAddress().toString() << ":" << data.size() << "字节";
+
+    // 首字节决定该连接的协议
+    if (client.mode == ClientBuffer::Mode::Unknown && !client.pending.isEmpty()) {
+        if (client.pending.at(0) == BinaryHandshake) {
+            client.mode = ClientBuffer::Mode::Binary;
+            client.pending.remove(0, 1);
+            qDebug() << "[Socket服务器] 客户端使用二进制帧协议";
+        } else {
+            client.mode = ClientBuffer::Mode::Ndjson;
+        }
+    }
+
+    if (client.mode == ClientBuffer::Mode::Binary) {
+        processBinary(clientSocket, client);
+    } else if (client.mode == ClientBuffer::Mode::Ndjson) {
+        processNdjson(client);
+    }
+}
+
+void SocketServerWorker::processNdjson(ClientBuffer& client)
+{
+    // 上一次超长行尚未结束：跳过直到下一个换行
+    if (client.discarding) {
+        const int newline = client.pending.indexOf('\n');
+        if (newline < 0) {
+            client.pending.clear();
+            return;
+        }
+        client.pending.remove(0, newline + 1);
+        client.discarding = false;
+    }
+
+    // 只处理以换行结尾的完整帧，剩余部分留待下次读取
+    const int lastNewline = client.pending.lastIndexOf('\n');
+    if (lastNewline >= 0) {
+        const QByteArray frames = client.pending.left(lastNewline + 1);
+        client.pending.remove(0, lastNewline + 1);
+        processSocketData(frames);
+    }
+
+    if (client.pending.size() > maxLineBytes) {
+        qDebug() << "[Socket服务器] 单行超过" << maxLineBytes << "字节，丢弃该行";
+        client.pending.clear();
+        client.discarding = true;
+    }
+}
+
+void SocketServerWorker::processBinary(QTcpSocket *socket, ClientBuffer& client)
+{
+    // 逐帧消费，最后一次性移除已处理前缀，避免逐帧搬移缓冲区
+    int offset = 0;
+    while (client.pending.size() - offset >= 4) {
+        const uchar *head = reinterpret_cast<const uchar*>(client.pending.constData()) + offset;
+        const quint32 length = qFromBigEndian<quint32>(head);
+        if (length == 0 || length > quint32(maxLineBytes)) {
+            qDebug() << "[Socket服务器] 二进制帧长度非法:" << length << "，断开连接";
+            client.pending.clear();
+            socket->disconnectFromHost();
+            return;
+        }
+        if (quint32(client.pending.size() - offset - 4) < length) {
+            break; // 帧未收全
+        }
+        const quint8 type = head[4];
+        const QByteArray payload = QByteArray::fromRawData(client.pending.constData() + offset + 5, int(length) - 1);
+        dispatchBinaryFrame(type, payload);
+        offset += 4 + int(length);
+    }
+    if (offset > 0) {
+        client.pending.remove(0, offset);
+    }
+}
+
+void SocketServerWorker::dispatchBinaryFrame(quint8 type, const QByteArray& payload)
+{
+    if (type != BinaryAsr && type != BinaryLlmStream) {
+        qDebug() << "[Socket数据处理] 未识别的二进制消息类型，忽略:" << type;
+        return;
+    }
+
+    QCborParserError perr;
+    const QCborValue value = QCborValue::fromCbor(payload, &perr);
+    if (perr.error != QCborError::NoError || !value.isMap()) {
+        qDebug() << "[Socket数据处理] CBOR解析失败，忽略:" << perr.errorString();
+        return;
+    }
+    const QCborMap map = value.toMap();
+    const QString text = map.value(QStringLiteral("text")).toString();
+    const bool isFinal = map.value(QStringLiteral("isFinal")).toBool(false);
+    if (type == BinaryAsr) {
+        emit asrReceived(text, isFinal);
+        return;
+    }
+    dispatchLlmStream(text, isFinal, map.value(QStringLiteral("emotion")).toString());
+}
+
+void SocketServerWorker::dispatchLlmStream(const QString& text, bool isFinal, const QString& emotion)
+{
+    // Java端发送的emotion字段（新格式）单独投递，文本进入合并队列
+    if (!emotion.isEmpty()) {
+        emit emotionReceived(emotion);
+    }
+    if (ingestQueue && !ingestQueue->push(text, isFinal)) {
+        setReadPaused(true);
+    }
+}
+
+void SocketServerWorker::onSocketError(QAbstractSocket::SocketError error)
+{
+    QTcpSocket* clientSocket = qobject_cast<QTcpSocket*>(sender());
+    if (clientSocket) {
+        QString clientIP = clientSocket->peerAddress().toString();
+        qDebug() << "[Socket服务器] 客户端错误" << clientIP << ":" << error << clientSocket->errorString();
+    }
+}
+
+void SocketServerWorker::processSocketData(const QByteArray& data)
+{
+    // 直接在原始字节上按换行切分，每行以切片形式分发，不做QString转换与拷贝
+    const char *cursor = data.constData();
+    const char *end = cursor + data.size();
+    while (cursor < end) {
+        const char *newline = static_cast<const char*>(std::memchr(cursor, '\n', size_t(end - cursor)));
+        const char *lineEnd = newline ? newline : end;
+        dispatchFrame(cursor, lineEnd);
+        cursor = newline ? newline + 1 : end;
+    }
+}
+
+void SocketServerWorker::dispatchFrame(const char *begin, const char *end)
+{
+    // 去掉首尾空白（含\r）
+    while (begin < end && isJsonSpace(*begin)) ++begin;
+    while (end > begin && isJsonSpace(*(end - 1))) --end;
+    if (begin == end) {
+        return;
+    }
+    const int length = int(end - begin);
+    if (length > maxLineBytes) {
+        qDebug() << "[Socket数据处理] 单行超过上限，忽略";
+        return;
+    }
+
+    // 先窥探顶层type字段，未知类型无需构建完整DOM；窥探无法确定时以完整解析为准
+    QLatin1String peekedType;
+    const PeekResult peek = peekJsonStringField(begin, end, "type", &peekedType);
+    if (peek != PeekResult::Ambiguous
+        && peekedType != QLatin1String("asr") && peekedType != QLatin1String("llm_stream")) {
+        // 其他格式的JSON数据暂不处理（旧的emotion_output格式已废弃）
+        qDebug() << "[Socket数据处理] 未识别的JSON格式，忽略:" << QByteArray(begin, length);
+        return;
+    }
+
+    // fromRawData不拷贝，按UTF-8字节直接解析
+    QJsonParseError perr;
+    const QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(begin, length), &perr);
+    if (perr.error != QJsonParseError::NoError || !doc.isObject()) {
+        qDebug() << "[Socket数据处理] JSON解析失败，忽略:" << perr.errorString();
+        return;
+    }
+    const QJsonObject obj = doc.object();
+    const QString type = obj.value("type").toString();
+    const bool isAsr = type == QLatin1String("asr");
+    const bool isLlm = type == QLatin1String("llm_stream");
+    if (!isAsr && !isLlm) {
+        qDebug() << "[Socket数据处理] 未识别的JSON格式，忽略:" << QByteArray(begin, length);
+        return;
+    }
+    const QString text = obj.value("text").toString();
+    const bool isFinal = obj.value("isFinal").toBool(false) || obj.value("is_final").toBool(false);
+    if (isAsr) {
+        emit asrReceived(text, isFinal);
+        return;
+    }
+    dispatchLlmStream(text, isFinal, obj.value("emotion").toString());
+}
+
+QString SocketServerWorker::getLocalIPAddress()
+{
+    // 获取本机IP地址
+    QList<QHostAddress> addresses = QNetworkInterface::allAddresses();
+    for (const QHostAddress &addr : addresses) {
+        if (addr.protocol() == QAbstractSocket::IPv4Protocol && addr != QHostAddress::LocalHost) {
+            return addr.toString();
+        }
+    }
+    return QHostAddress(QHostAddress::LocalHost).toString();
+}
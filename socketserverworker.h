@@ -0,0 +1,81 @@
+#ifndef SOCKETSERVERWORKER_H
+#define SOCKETSERVERWORKER_H
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QList>
+#include <QByteArray>
+#include <QHash>
+#include "llmingestqueue.h"
+
+// Socket服务器工作对象：运行在独立的网络I/O线程中，负责监听、读取与解析，
+// 解析后的消息以信号形式（跨线程自动排队）交给GUI线程的Widget。
+//
+// 同一端口支持两种协议，由连接建立后的首字节决定：
+//   - 默认：逐行JSON（NDJSON），每条消息以"\n"结尾；
+//   - 首字节为 BinaryHandshake(0xB1)：二进制帧，每帧为
+//     quint32 长度（大端，含类型字节） + quint8 消息类型 + CBOR map 负载
+//     （键与JSON一致：text / isFinal / emotion）。
+class SocketServerWorker : public QObject
+{
+    Q_OBJECT
+public:
+    static const char BinaryHandshake = char(0xB1);
+    enum BinaryMessageType : quint8 {
+        BinaryAsr = 0x01,
+        BinaryLlmStream = 0x02
+    };
+
+    // ingest 为GUI线程持有的LLM入队缓冲，llm_stream 文本直接推入其中
+    SocketServerWorker(quint16 port, LlmIngestQueue *ingest, QObject *parent = nullptr);
+    ~SocketServerWorker();
+
+public slots:
+    // 须在工作线程内调用（连接QThread::started）
+    void start();
+    void stop();
+    // 背压：暂停时不再从socket读取，数据留在内核缓冲区，由TCP窗口限制对端发送
+    void setReadPaused(bool paused);
+
+signals:
+    void serverStateChanged(bool running, quint16 port);
+    void asrReceived(const QString& text, bool isFinal);
+    // llm_stream 中Java端附带的情感字段（文本本身进入入队缓冲）
+    void emotionReceived(const QString& emotion);
+
+private slots:
+    void onNewConnection();
+    void onClientDisconnected();
+    void onDataReceived();
+    void onSocketError(QAbstractSocket::SocketError error);
+
+private:
+    // 每个连接的增量分帧状态：保留跨读取的不完整行
+    struct ClientBuffer {
+        enum class Mode { Unknown, Ndjson, Binary };
+        QByteArray pending;
+        Mode mode = Mode::Unknown;
+        bool discarding = false; // 正在跳过超长行的剩余部分
+    };
+
+    void readClient(QTcpSocket *socket);
+    void dispatchLlmStream(const QString& text, bool isFinal, const QString& emotion);
+    void processNdjson(ClientBuffer& client);
+    void processBinary(QTcpSocket *socket, ClientBuffer& client);
+    void dispatchBinaryFrame(quint8 type, const QByteArray& payload);
+    void processSocketData(const QByteArray& data);
+    void dispatchFrame(const char *begin, const char *end);
+    QString getLocalIPAddress();
+
+    QTcpServer *tcpServer;
+    QList<QTcpSocket*> clientSockets;
+    QHash<QTcpSocket*, ClientBuffer> clientBuffers;
+    int maxLineBytes; // 单行JSON上限，超出整行丢弃
+    LlmIngestQueue *ingestQueue;
+    bool readPaused;
+    quint16 serverPort;
+    bool isServerRunning;
+};
+
+#endif // SOCKETSERVERWORKER_H
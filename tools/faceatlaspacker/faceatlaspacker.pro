@@ -0,0 +1,19 @@
+# 离线图集打包工具：将同尺寸PNG帧序列打包为可内存映射的 .fatlas
+# 用法示例：
+#   faceatlaspacker --size 1280x800 -o searching.fatlas qt_face/searching/1.png qt_face/searching/2.png ...
+QT += core gui
+QT -= widgets
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = faceatlaspacker
+
+INCLUDEPATH += ../..
+
+SOURCES += \
+    main.cpp \
+    ../../faceatlas.cpp
+
+HEADERS += \
+    ../../faceatlas.h
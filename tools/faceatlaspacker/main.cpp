@@ -0,0 +1,75 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QImage>
+#include <QPainter>
+#include <QColor>
+#include <QTextStream>
+#include "faceatlas.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("faceatlaspacker");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Pack PNG face frames into a memory-mappable .fatlas file");
+    parser.addHelpOption();
+    QCommandLineOption outputOption(QStringList() << "o" << "output", "Output .fatlas path.", "file");
+    QCommandLineOption sizeOption("size", "Pre-scale frames to WxH (the on-device canvas size).", "WxH");
+    QCommandLineOption backgroundOption("background", "Flatten transparency onto this colour (keeps alpha if omitted).", "color");
+    parser.addOption(outputOption);
+    parser.addOption(sizeOption);
+    parser.addOption(backgroundOption);
+    parser.addPositionalArgument("frames", "Frame images in playback order.", "frames...");
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QStringList inputs = parser.positionalArguments();
+    if (!parser.isSet(outputOption) || inputs.isEmpty()) {
+        parser.showHelp(1);
+    }
+
+    QSize targetSize;
+    if (parser.isSet(sizeOption)) {
+        const QStringList parts = parser.value(sizeOption).split('x');
+        if (parts.size() == 2) {
+            targetSize = QSize(parts.at(0).toInt(), parts.at(1).toInt());
+        }
+        if (!targetSize.isValid() || targetSize.isEmpty()) {
+            err << "invalid --size: " << parser.value(sizeOption) << "\n";
+            return 1;
+        }
+    }
+    const QColor background = parser.isSet(backgroundOption) ? QColor(parser.value(backgroundOption)) : QColor();
+    const QImage::Format format = background.isValid() ? QImage::Format_RGB32 : QImage::Format_ARGB32_Premultiplied;
+
+    QList<QImage> frames;
+    for (const QString& path : inputs) {
+        QImage img(path);
+        if (img.isNull()) {
+            err << "cannot read " << path << "\n";
+            return 1;
+        }
+        if (targetSize.isValid()) {
+            img = img.scaled(targetSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        }
+        if (background.isValid() && img.hasAlphaChannel()) {
+            // 压平为不透明帧，设备上绘制时只需直接拷贝
+            QImage opaque(img.size(), QImage::Format_RGB32);
+            opaque.fill(background);
+            QPainter p(&opaque);
+            p.drawImage(0, 0, img);
+            p.end();
+            img = opaque;
+        }
+        frames.append(img);
+    }
+
+    QString error;
+    if (!FaceAtlas::write(parser.value(outputOption), frames, format, &error)) {
+        err << "write failed: " << error << "\n";
+        return 1;
+    }
+    QTextStream(stdout) << "packed " << frames.size() << " frames into " << parser.value(outputOption) << "\n";
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "voiceactivitydetector.h"
+#include <cstring>
+
+namespace {
+// 开头用于估计噪声底的帧数（200ms）
+const int kCalibrationFrames = 20;
+// 连续语音帧数达到该值才判为开口，滤掉按键声等短促噪声（50ms）
+const int kOnsetFrames = 5;
+// 噪声底下限，避免安静环境下阈值过低（约 -70dBFS）
+const quint32 kMinNoiseEnergy = 100;
+// 语音帧能量绝对下限（均方根约200，-44dBFS）
+const quint32 kMinSpeechEnergy = 40000;
+// 语音帧能量需高于噪声底的倍数（约8dB）
+const quint32 kSpeechToNoise = 6;
+// 过零次数超过该值（平均频率约3.2kHz）的帧多为嘶声/风噪，需更高能量才算语音
+const int kMaxVoicedCrossings = 64;
+// 噪声底跟踪速度：每帧向当前能量靠近 1/16
+const int kNoiseAdaptShift = 4;
+}
+
+VoiceActivityDetector::VoiceActivityDetector()
+{
+    reset();
+}
+
+VoiceActivityDetector::FrameFeatures VoiceActivityDetector::analyzeFrame(const qint16 *samples, int count)
+{
+    FrameFeatures f = { 0, 0 };
+    if (count <= 0) {
+        return f;
+    }
+    // 纯整数累加：采样平方和最大 160 * 2^30，用64位累加不会溢出；
+    // 符号不同则异或结果为负，右移取符号位即得过零
+    quint64 sumSquares = 0;
+    int crossings = 0;
+    int prev = samples[0];
+    for (int i = 0; i < count; ++i) {
+        const int s = samples[i];
+        sumSquares += quint64(s * s);
+        crossings += ((prev ^ s) >> 31) & 1;
+        prev = s;
+    }
+    f.energy = quint32(sumSquares / quint64(count));
+    f.zeroCrossings = crossings;
+    return f;
+}
+
+void VoiceActivityDetector::reset()
+{
+    pendingCount = 0;
+    frameCount = 0;
+    noiseFloor = 0xFFFFFFFFu;
+    speechRun = 0;
+    speechStartFrame = -1;
+    lastSpeechFrame = -1;
+}
+
+void VoiceActivityDetector::process(const qint16 *samples, int count)
+{
+    // 先补齐上次剩下的半帧
+    if (pendingCount > 0) {
+        const int n = qMin(count, FRAME_SAMPLES - pendingCount);
+        std::memcpy(pending + pendingCount, samples, size_t(n) * sizeof(qint16));
+        pendingCount += n;
+        samples += n;
+        count -= n;
+        if (pendingCount < FRAME_SAMPLES) {
+            return;
+        }
+        processFrame(pending);
+        pendingCount = 0;
+    }
+    while (count >= FRAME_SAMPLES) {
+        processFrame(samples);
+        samples += FRAME_SAMPLES;
+        count -= FRAME_SAMPLES;
+    }
+    if (count > 0) {
+        std::memcpy(pending, samples, size_t(count) * sizeof(qint16));
+        pendingCount = count;
+    }
+}
+
+bool VoiceActivityDetector::isSpeechFrame(const FrameFeatures& f) const
+{
+    const quint64 threshold = qMax<quint64>(quint64(noiseFloor) * kSpeechToNoise, kMinSpeechEnergy);
+    if (f.energy < threshold) {
+        return false;
+    }
+    return f.zeroCrossings <= kMaxVoicedCrossings || f.energy >= threshold * 4;
+}
+
+void VoiceActivityDetector::processFrame(const qint16 *frame)
+{
+    const FrameFeatures f = analyzeFrame(frame, FRAME_SAMPLES);
+    const qint64 index = frameCount++;
+
+    if (index < kCalibrationFrames) {
+        noiseFloor = qMax(kMinNoiseEnergy, qMin(noiseFloor, f.energy));
+    }
+
+    if (isSpeechFrame(f)) {
+        ++speechRun;
+        if (speechStartFrame < 0 && speechRun >= kOnsetFrames) {
+            speechStartFrame = index - kOnsetFrames + 1;
+        }
+        if (speechStartFrame >= 0) {
+            lastSpeechFrame = index;
+        }
+        return;
+    }
+
+    speechRun = 0;
+    if (index >= kCalibrationFrames) {
+        const qint64 delta = (qint64(f.energy) - qint64(noiseFloor)) / (1 << kNoiseAdaptShift);
+        noiseFloor = quint32(qMax<qint64>(kMinNoiseEnergy, qint64(noiseFloor) + delta));
+    }
+}
+
+qint64 VoiceActivityDetector::trailingSilenceMs() const
+{
+    if (speechStartFrame < 0) {
+        return processedMs();
+    }
+    return (frameCount - lastSpeechFrame - 1) * FRAME_MS;
+}
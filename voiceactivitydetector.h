@@ -0,0 +1,52 @@
+#ifndef VOICEACTIVITYDETECTOR_H
+#define VOICEACTIVITYDETECTOR_H
+
+#include <QtGlobal>
+
+// 能量 + 过零率语音检测，针对 16kHz 单声道 16bit PCM，按10ms帧（160个采样）判定。
+// 全部为整数运算，开发板上每帧只需一次累加循环。
+// 噪声底取开头200ms内的最低帧能量，之后在非语音帧上缓慢跟踪；
+// 连续50ms的语音帧判为开口，最后一个语音帧之后的时长即为尾部静音。
+class VoiceActivityDetector
+{
+public:
+    static const int SAMPLE_RATE = 16000;
+    static const int FRAME_MS = 10;
+    static const int FRAME_SAMPLES = SAMPLE_RATE / 1000 * FRAME_MS;
+
+    struct FrameFeatures {
+        quint32 energy;      // 均方能量（采样平方的平均值）
+        int zeroCrossings;   // 帧内过零次数
+    };
+
+    VoiceActivityDetector();
+
+    // 单帧特征；count 一般为 FRAME_SAMPLES
+    static FrameFeatures analyzeFrame(const qint16 *samples, int count);
+
+    void reset();
+    // 追加采样，不足一帧的部分留到下次
+    void process(const qint16 *samples, int count);
+
+    bool speechDetected() const { return speechStartFrame >= 0; }
+    // 语音起止时间（相对采集开始，毫秒）；未检测到语音时为-1
+    qint64 speechStartMs() const { return speechStartFrame < 0 ? -1 : qint64(speechStartFrame) * FRAME_MS; }
+    qint64 speechEndMs() const { return speechStartFrame < 0 ? -1 : qint64(lastSpeechFrame + 1) * FRAME_MS; }
+    // 最后一个语音帧之后的静音时长
+    qint64 trailingSilenceMs() const;
+    qint64 processedMs() const { return qint64(frameCount) * FRAME_MS; }
+
+private:
+    void processFrame(const qint16 *frame);
+    bool isSpeechFrame(const FrameFeatures& f) const;
+
+    qint16 pending[FRAME_SAMPLES];
+    int pendingCount;
+    qint64 frameCount;
+    quint32 noiseFloor;
+    int speechRun;             // 连续语音帧数
+    qint64 speechStartFrame;
+    qint64 lastSpeechFrame;
+};
+
+#endif // VOICEACTIVITYDETECTOR_H
@@ -0,0 +1,393 @@
+#include "voicecapture.h"
+#include <QAudioInput>
+#include <QAudioDeviceInfo>
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+#include <cmath>
+
+namespace {
+// 采集缓冲约100ms，兼顾延迟与开发板上的调度抖动
+const int kInputBufferMs = 100;
+}
+
+VoiceCapture::VoiceCapture(QObject *parent)
+    : QObject(parent)
+    , input(nullptr)
+    , device(nullptr)
+    , head(0)
+    , filled(0)
+    , overwritten(0)
+    , converting(false)
+    , resampleStep(1.0)
+    , resamplePos(0.0)
+    , resamplePrev(0.0f)
+    , boxIndex(0)
+    , boxSum(0.0f)
+    , levelIntervalMs(16)
+    , levelSumSquares(0)
+    , levelSamples(0)
+    , levelPeak(0)
+    , takeSumSquares(0)
+    , takeSamples(0)
+    , takePeakValue(0)
+{
+    setMaxDurationMs(DEFAULT_MAX_DURATION_MS);
+}
+
+VoiceCapture::~VoiceCapture()
+{
+    stop();
+}
+
+QAudioFormat VoiceCapture::captureFormat()
+{
+    QAudioFormat format;
+    format.setSampleRate(SAMPLE_RATE);
+    format.setChannelCount(1);
+    format.setSampleSize(BYTES_PER_SAMPLE * 8);
+    format.setCodec("audio/pcm");
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setSampleType(QAudioFormat::SignedInt);
+    return format;
+}
+
+QByteArray VoiceCapture::wavHeader(quint32 dataBytes)
+{
+    const quint32 byteRate = SAMPLE_RATE * BYTES_PER_SAMPLE;
+    const quint32 riffSize = dataBytes == 0xFFFFFFFFu ? 0xFFFFFFFFu : dataBytes + 36;
+
+    QByteArray header(44, '\0');
+    uchar *p = reinterpret_cast<uchar*>(header.data());
+    std::memcpy(p, "RIFF", 4);
+    qToLittleEndian<quint32>(riffSize, p + 4);
+    std::memcpy(p + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, p + 16);                       // fmt块长度
+    qToLittleEndian<quint16>(1, p + 20);                        // PCM
+    qToLittleEndian<quint16>(1, p + 22);                        // 单声道
+    qToLittleEndian<quint32>(SAMPLE_RATE, p + 24);
+    qToLittleEndian<quint32>(byteRate, p + 28);
+    qToLittleEndian<quint16>(BYTES_PER_SAMPLE, p + 32);         // blockAlign
+    qToLittleEndian<quint16>(BYTES_PER_SAMPLE * 8, p + 34);     // bitsPerSample
+    std::memcpy(p + 36, "data", 4);
+    qToLittleEndian<quint32>(dataBytes, p + 40);
+    return header;
+}
+
+void VoiceCapture::setMaxDurationMs(int ms)
+{
+    if (input) {
+        return;
+    }
+    const int bytes = qMax(1, ms) * (SAMPLE_RATE / 1000) * BYTES_PER_SAMPLE;
+    if (ring.size() != bytes) {
+        ring = QByteArray(bytes, '\0');
+    }
+    head = 0;
+    filled = 0;
+    overwritten = 0;
+}
+
+int VoiceCapture::maxDurationMs() const
+{
+    return ring.size() / ((SAMPLE_RATE / 1000) * BYTES_PER_SAMPLE);
+}
+
+bool VoiceCapture::start(QString *errorString)
+{
+    stop();
+    // 复用已分配的缓冲
+    levelClock.invalidate();
+    head = 0;
+    filled = 0;
+    overwritten = 0;
+    carry.clear();
+    levelSumSquares = 0;
+    levelSamples = 0;
+    levelPeak = 0;
+    takeSumSquares = 0;
+    takeSamples = 0;
+    takePeakValue = 0;
+
+    const QAudioDeviceInfo info = QAudioDeviceInfo::defaultInputDevice();
+    if (info.isNull()) {
+        if (errorString) {
+            *errorString = QStringLiteral("没有可用的录音设备");
+        }
+        return false;
+    }
+    // 很多设备只提供44.1/48kHz：取最接近的格式采集，读到后再转换
+    deviceFormat = captureFormat();
+    if (!info.isFormatSupported(deviceFormat)) {
+        deviceFormat = info.nearestFormat(deviceFormat);
+        if (!canConvert(deviceFormat)) {
+            if (errorString) {
+                *errorString = QStringLiteral("录音设备不支持PCM采集");
+            }
+            return false;
+        }
+    }
+    converting = deviceFormat != captureFormat();
+    if (converting) {
+        resampleStep = double(deviceFormat.sampleRate()) / SAMPLE_RATE;
+        resamplePos = 0.0;
+        resamplePrev = 0.0f;
+        // 降采样时先按比例做滑动平均，抑制高于8kHz的成分折叠进语音频段
+        boxHistory.fill(0.0f, qMax(1, int(resampleStep)));
+        boxIndex = 0;
+        boxSum = 0.0f;
+        qDebug() << "录音设备不支持16kHz单声道，按设备格式采集后转换:" << deviceFormat;
+    }
+
+    input = new QAudioInput(info, deviceFormat, this);
+    input->setBufferSize(deviceFormat.bytesForDuration(qint64(kInputBufferMs) * 1000));
+    device = input->start();
+    if (!device) {
+        if (errorString) {
+            *errorString = QStringLiteral("无法启动录音设备");
+        }
+        delete input;
+        input = nullptr;
+        return false;
+    }
+    connect(device, &QIODevice::readyRead, this, &VoiceCapture::onReadyRead);
+    qDebug() << "开始采集PCM:" << info.deviceName();
+    return true;
+}
+
+void VoiceCapture::stop()
+{
+    if (!input) {
+        return;
+    }
+    // 读出驱动中剩余的数据再停止
+    onReadyRead();
+    disconnect(device, nullptr, this, nullptr);
+    input->stop();
+    input->deleteLater();
+    input = nullptr;
+    device = nullptr;
+    emit levelChanged(0.0f, 0.0f);
+    emit stopped();
+}
+
+void VoiceCapture::onReadyRead()
+{
+    if (!device) {
+        return;
+    }
+    QByteArray chunk = carry + device->readAll();
+    // 只处理完整的帧，半帧留到下一块，避免字节错位
+    const int frameBytes = converting ? deviceFormat.bytesPerFrame() : BYTES_PER_SAMPLE;
+    const int tail = chunk.size() % frameBytes;
+    carry = chunk.right(tail);
+    chunk.chop(tail);
+    if (converting && !chunk.isEmpty()) {
+        convertChunk(chunk.constData(), chunk.size());
+        chunk = converted;
+    }
+    if (chunk.isEmpty()) {
+        return;
+    }
+    writeRing(chunk.constData(), chunk.size());
+    accumulateLevel(reinterpret_cast<const qint16*>(chunk.constData()), chunk.size() / BYTES_PER_SAMPLE);
+    emit pcmCaptured(chunk);
+}
+
+bool VoiceCapture::canConvert(const QAudioFormat& format)
+{
+    if (!format.isValid() || format.codec() != QLatin1String("audio/pcm") || format.channelCount() < 1) {
+        return false;
+    }
+    switch (format.sampleSize()) {
+    case 8:
+    case 16:
+        return format.sampleType() == QAudioFormat::SignedInt || format.sampleType() == QAudioFormat::UnSignedInt;
+    case 32:
+        return format.sampleType() == QAudioFormat::SignedInt || format.sampleType() == QAudioFormat::Float;
+    default:
+        return false;
+    }
+}
+
+float VoiceCapture::readMonoFrame(const uchar *frame) const
+{
+    const bool little = deviceFormat.byteOrder() == QAudioFormat::LittleEndian;
+    const int channels = deviceFormat.channelCount();
+    const int sampleBytes = deviceFormat.sampleSize() / 8;
+    float sum = 0.0f;
+    for (int c = 0; c < channels; ++c) {
+        const uchar *p = frame + c * sampleBytes;
+        float v = 0.0f;
+        switch (deviceFormat.sampleSize()) {
+        case 8:
+            v = deviceFormat.sampleType() == QAudioFormat::UnSignedInt ? (int(*p) - 128) / 128.0f
+                                                                       : qint8(*p) / 128.0f;
+            break;
+        case 16: {
+            const quint16 raw = little ? qFromLittleEndian<quint16>(p) : qFromBigEndian<quint16>(p);
+            v = deviceFormat.sampleType() == QAudioFormat::UnSignedInt ? (int(raw) - 32768) / 32768.0f
+                                                                       : qint16(raw) / 32768.0f;
+            break;
+        }
+        default: {
+            const quint32 raw = little ? qFromLittleEndian<quint32>(p) : qFromBigEndian<quint32>(p);
+            if (deviceFormat.sampleType() == QAudioFormat::Float) {
+                std::memcpy(&v, &raw, sizeof(v));
+            } else {
+                v = qint32(raw) / 2147483648.0f;
+            }
+            break;
+        }
+        }
+        sum += v;
+    }
+    return sum / channels;
+}
+
+void VoiceCapture::convertChunk(const char *data, int size)
+{
+    const int frameBytes = deviceFormat.bytesPerFrame();
+    const int frames = size / frameBytes;
+    // 输出采样数不超过 frames / step + 1；converted 容量跨块复用
+    converted.resize(int(frames / resampleStep + 2) * BYTES_PER_SAMPLE);
+    qint16 *out = reinterpret_cast<qint16*>(converted.data());
+    int produced = 0;
+
+    const uchar *p = reinterpret_cast<const uchar*>(data);
+    const int box = boxHistory.size();
+    float prev = resamplePrev;
+    for (int i = 0; i < frames; ++i) {
+        float cur = readMonoFrame(p + i * frameBytes);
+        if (box > 1) {
+            boxSum += cur - boxHistory[boxIndex];
+            boxHistory[boxIndex] = cur;
+            boxIndex = (boxIndex + 1) % box;
+            cur = boxSum / box;
+        }
+        // 线性插值：输出位置落在 (i-1, i] 之间的采样由 prev 与 cur 插出
+        while (resamplePos <= i) {
+            const float frac = float(resamplePos - (i - 1));
+            const float v = prev + (cur - prev) * frac;
+            out[produced++] = qint16(qBound(-32768, qRound(v * 32768.0f), 32767));
+            resamplePos += resampleStep;
+        }
+        prev = cur;
+    }
+    resamplePrev = prev;
+    resamplePos -= frames;
+    converted.resize(produced * BYTES_PER_SAMPLE);
+}
+
+void VoiceCapture::accumulateLevel(const qint16 *samples, int count)
+{
+    // 小端16bit与本机字节序一致，直接按qint16累计
+    quint64 sumSquares = 0;
+    int peak = 0;
+    for (int i = 0; i < count; ++i) {
+        const int s = samples[i];
+        sumSquares += quint64(s * s);
+        peak = qMax(peak, qAbs(s));
+    }
+    levelSumSquares += sumSquares;
+    levelSamples += count;
+    levelPeak = qMax(levelPeak, peak);
+    takeSumSquares += sumSquares;
+    takeSamples += count;
+    takePeakValue = qMax(takePeakValue, peak);
+
+    // 一个刷新周期内的多块数据合并为一次通知
+    if (levelClock.isValid() && levelClock.elapsed() < levelIntervalMs) {
+        return;
+    }
+    levelClock.start();
+    const float rms = std::sqrt(float(levelSumSquares) / float(qMax<qint64>(1, levelSamples))) / 32768.0f;
+    const float peakLevel = levelPeak / 32768.0f;
+    levelSumSquares = 0;
+    levelSamples = 0;
+    levelPeak = 0;
+    emit levelChanged(rms, peakLevel);
+}
+
+float VoiceCapture::takeRms() const
+{
+    if (takeSamples == 0) {
+        return 0.0f;
+    }
+    return std::sqrt(float(takeSumSquares) / float(takeSamples)) / 32768.0f;
+}
+
+void VoiceCapture::writeRing(const char *data, int size)
+{
+    const int capacity = ring.size();
+    if (size >= capacity) {
+        // 单块超过容量：只保留最后 capacity 字节
+        overwritten += filled + size - capacity;
+        std::memcpy(ring.data(), data + size - capacity, size_t(capacity));
+        head = 0;
+        filled = capacity;
+        return;
+    }
+    const int first = qMin(size, capacity - head);
+    std::memcpy(ring.data() + head, data, size_t(first));
+    std::memcpy(ring.data(), data + first, size_t(size - first));
+    head = (head + size) % capacity;
+    const int excess = filled + size - capacity;
+    if (excess > 0) {
+        overwritten += excess;
+    }
+    filled = qMin(capacity, filled + size);
+}
+
+void VoiceCapture::appendRange(QByteArray *out, qint64 from, qint64 to) const
+{
+    // 偏移换算为环内位置：缓冲中最早的字节对应偏移 overwritten
+    const int capacity = ring.size();
+    const int begin = (head - filled + capacity) % capacity;
+    const int offset = int(from - overwritten);
+    const int size = int(to - from);
+    const int start = (begin + offset) % capacity;
+    const int first = qMin(size, capacity - start);
+    out->append(ring.constData() + start, first);
+    out->append(ring.constData(), size - first);
+}
+
+QByteArray VoiceCapture::pcm() const
+{
+    return pcm(overwritten, capturedBytes());
+}
+
+QByteArray VoiceCapture::wav() const
+{
+    return wav(overwritten, capturedBytes());
+}
+
+QByteArray VoiceCapture::pcm(qint64 from, qint64 to) const
+{
+    from = qMax(from, overwritten);
+    to = qMin(to, capturedBytes());
+    QByteArray out;
+    if (to > from) {
+        out.reserve(int(to - from));
+        appendRange(&out, from, to);
+    }
+    return out;
+}
+
+QByteArray VoiceCapture::wav(qint64 from, qint64 to) const
+{
+    from = qMax(from, overwritten);
+    to = qMax(from, qMin(to, capturedBytes()));
+    QByteArray out;
+    out.reserve(44 + int(to - from));
+    out.append(wavHeader(quint32(to - from)));
+    if (to > from) {
+        appendRange(&out, from, to);
+    }
+    return out;
+}
+
+qint64 VoiceCapture::durationMs() const
+{
+    return qint64(filled) * 1000 / (SAMPLE_RATE * BYTES_PER_SAMPLE);
+}
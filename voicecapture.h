@@ -0,0 +1,108 @@
+#ifndef VOICECAPTURE_H
+#define VOICECAPTURE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QAudioFormat>
+#include <QElapsedTimer>
+#include <QVector>
+
+class QAudioInput;
+class QIODevice;
+
+// 16kHz 单声道 16bit PCM 采集（QAudioInput），不落盘：
+// 采样写入预分配的环形缓冲（容量由 setMaxDurationMs 决定，录音过程中不再分配），写满后覆盖最早的数据；
+// 每次读到的数据块同时经 pcmCaptured() 发出（供边录边传）。上传用的WAV头在内存中生成。
+// 读数据时顺带累计均方根/峰值，按 setLevelIntervalMs 的间隔（一般取屏幕刷新周期）发出 levelChanged()。
+// 设备不支持16kHz单声道16bit时按 nearestFormat() 采集，写入缓冲前混为单声道并重采样到16kHz 16bit
+class VoiceCapture : public QObject
+{
+    Q_OBJECT
+public:
+    static const int SAMPLE_RATE = 16000;
+    static const int BYTES_PER_SAMPLE = 2;
+    static const int DEFAULT_MAX_DURATION_MS = 15000;
+
+    explicit VoiceCapture(QObject *parent = nullptr);
+    ~VoiceCapture() override;
+
+    static QAudioFormat captureFormat();
+    // 44字节WAV头；dataBytes为0xFFFFFFFF时表示长度未知（流式上传）
+    static QByteArray wavHeader(quint32 dataBytes);
+
+    // 按最长录音时长预分配缓冲；录音中调用无效
+    void setMaxDurationMs(int ms);
+    int maxDurationMs() const;
+
+    bool start(QString *errorString = nullptr);
+    void stop();
+    bool isActive() const { return input != nullptr; }
+
+    // 本次录音的PCM（按时间顺序）与对应的完整WAV
+    QByteArray pcm() const;
+    QByteArray wav() const;
+    // 指定区间 [from, to)（采集开始以来的字节偏移）的PCM与WAV，已被覆盖或尚未采集的部分被裁掉
+    QByteArray pcm(qint64 from, qint64 to) const;
+    QByteArray wav(qint64 from, qint64 to) const;
+    qint64 durationMs() const;
+    // 采集开始以来的字节数（含已被覆盖的部分）
+    qint64 capturedBytes() const { return overwritten + filled; }
+    static qint64 bytesForMs(qint64 ms) { return ms * (SAMPLE_RATE / 1000) * BYTES_PER_SAMPLE; }
+    // 电平通知间隔，默认16ms（60Hz）
+    void setLevelIntervalMs(int ms) { levelIntervalMs = qMax(1, ms); }
+    // 整段录音的均方根与峰值，0~1（满幅为1）
+    float takeRms() const;
+    float takePeak() const { return takePeakValue / 32768.0f; }
+
+    // 超出容量被覆盖的字节数
+    qint64 overwrittenBytes() const { return overwritten; }
+
+signals:
+    void pcmCaptured(const QByteArray& chunk);
+    void stopped();
+    // 上次通知以来的均方根与峰值，0~1（满幅为1）；停止时发出一次 (0, 0)
+    void levelChanged(float rms, float peak);
+
+private slots:
+    void onReadyRead();
+
+private:
+    void writeRing(const char *data, int size);
+    void appendRange(QByteArray *out, qint64 from, qint64 to) const;
+    void accumulateLevel(const qint16 *samples, int count);
+    static bool canConvert(const QAudioFormat& format);
+    // 设备格式的一帧（各声道）混为单声道，-1~1
+    float readMonoFrame(const uchar *frame) const;
+    // 设备格式数据（整帧）转换为16kHz单声道16bit，结果写入 converted
+    void convertChunk(const char *data, int size);
+
+    QAudioInput *input;
+    QIODevice *device;
+    QByteArray ring;  // 预分配的环形缓冲
+    int head;         // 下一个写入位置
+    int filled;       // 有效字节数
+    qint64 overwritten;
+    QByteArray carry; // 不足一帧的尾部字节
+
+    // 设备格式与转换状态（设备直接支持采集格式时不转换）
+    QAudioFormat deviceFormat;
+    bool converting;
+    double resampleStep;       // 每个输出采样对应的输入采样数
+    double resamplePos;        // 下一个输出采样在当前块中的位置，-1 表示上一块的最后一个采样
+    float resamplePrev;
+    QVector<float> boxHistory; // 降采样前的滑动平均（抗混叠）
+    int boxIndex;
+    float boxSum;
+    QByteArray converted;      // 转换结果，跨块复用
+
+    int levelIntervalMs;
+    QElapsedTimer levelClock;
+    quint64 levelSumSquares;   // 本通知间隔内
+    qint64 levelSamples;
+    int levelPeak;
+    quint64 takeSumSquares;    // 整段录音
+    qint64 takeSamples;
+    int takePeakValue;
+};
+
+#endif // VOICECAPTURE_H
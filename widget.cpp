@@ -15,22 +15,30 @@
 #include <QCoreApplication>
 // 新增：HTTP流式与多部分上传所需头文件
 #include <QNetworkRequest>
-#include <QHttpMultiPart>
 #include <QFile>
-#include <QUrlQuery>
 #include <QHostAddress>
 #include <QSizePolicy>
-#include <QScrollBar>
-#include <QTextCursor>
 #include <QRandomGenerator> // 新增：用于随机眨眼
 #include "interfacewidget.h"
 #include <functional>
 #include <QDir>
+#include <QPainter>
+#include <QTextBoundaryFinder>
 
 namespace {
+// 表情资源来自 qt_face.qrc（内嵌或外部映射的rcc），不再依赖运行目录的相对路径
 inline QString faceRes(const QString &file) {
-    return QDir(QCoreApplication::applicationDirPath()).filePath("../../faceshiftDemo2/qt_face/" + file);
-    //return QDir(QCoreApplication::applicationDirPath()).filePath("../faceshiftDemo2/qt_face/" + file);
+    return QStringLiteral(":/qt_face/") + file;
+}
+
+inline QString expressionAssetFile(ExpressionType type) {
+    switch (type) {
+        case ExpressionType::Happy:    return QStringLiteral("emotion_happy.png");
+        case ExpressionType::Sad:      return QStringLiteral("emotion_sad.png");
+        case ExpressionType::Warning:  return QStringLiteral("emotion_warning.png");
+        case ExpressionType::Sleep:    return QStringLiteral("sleep.png");
+        default: /* Normal */          return QStringLiteral("normal.png");
+    }
 }
 
 inline int randomBlinkIntervalMs() {
@@ -41,21 +49,28 @@ inline int randomBlinkIntervalMs() {
 Widget::Widget(QWidget *parent)
     : QWidget(parent)
     , ui(new Ui::Widget)
+    , faceCanvas(nullptr)
     , currentExpression(ExpressionType::Normal)
     , isAnimating(false)
     , fromExpression(ExpressionType::Happy)
     , toExpression(ExpressionType::Sad)
 
-    , imageAnimationTimer(new QTimer(this))
-    , currentImageFrame(0)
+    , imageSequenceCacheBytes(0)
+    , imageSequenceCacheLimitBytes(96LL * 1024 * 1024)
     , interpolationBasePath("face")
+    , atlasBasePath("atlas")
     , useImageSequences(false)
+    , imageAnimationIntervalMs(50)
+    , useCrossFade(true)
+    , crossFadeDurationMs(300)
+    , crossFadeEasing(QEasingCurve::InOutQuad)
     , expressionDurationTimer(new QTimer(this))
     , previousExpression(ExpressionType::Normal)
-    , tcpServer(nullptr)
+    , socketThread(nullptr)
+    , socketWorker(nullptr)
     , serverPort(8888)
     , isServerRunning(false)
-    , imageAnimationIntervalMs(50)
+    , assetLoader(nullptr)
     , currentMode(Mode::Expression)
     , interfaceWidget(nullptr)
     , registrationWidget(nullptr)
@@ -64,6 +79,10 @@ Widget::Widget(QWidget *parent)
     setWindowTitle("智能用药提醒机器人表情系统");
     resize(1280, 800); // 适配800x1280屏幕
     setupFaceDisplay();
+
+    // 部署了插值序列目录时启用序列过渡
+    useImageSequences = interpolationDir().exists();
+    qDebug() << "[图像序列] 目录:" << interpolationDir().absolutePath() << "启用:" << useImageSequences;
     
     // 连接表情持续时间定时器
     connect(expressionDurationTimer, &QTimer::timeout, this, &Widget::onExpressionDurationTimeout);
@@ -76,15 +95,38 @@ Widget::Widget(QWidget *parent)
     connect(idleTimer, &QTimer::timeout, this, &Widget::onIdleTimeout);
     idleTimer->start();
     
+    // LLM token 入队缓冲：合并每轮事件循环内到达的token，积压超过水位时对生产者施加背压
+    llmIngest = new LlmIngestQueue(this);
+    llmIngest->setWatermarks(8000, 2000);
+    connect(llmIngest, &LlmIngestQueue::dataAvailable, this, &Widget::onLlmIngestAvailable, Qt::QueuedConnection);
+    connect(llmIngest, &LlmIngestQueue::backpressureChanged, this, &Widget::onLlmBackpressureChanged, Qt::QueuedConnection);
+
     // 初始化Socket服务器
     initializeSocketServer();
     
     // ========== 新增：HTTP流式接入初始化 ==========
     nerNam = new QNetworkAccessManager(this);
-    nerReply = nullptr;
+    nerSessions = new NerSessionManager(nerNam, llmIngest, this);
+    connect(nerSessions, &NerSessionManager::displayedSessionChanged, this, &Widget::onNerSessionShown);
+    connect(nerSessions, &NerSessionManager::emotionReceived, this, [this](const QString& emotion) {
+        processJavaEmotion(emotion);
+    });
+    connect(nerSessions, &NerSessionManager::activity, this, [this]() { resetIdleTimer(); });
+    connect(nerSessions, &NerSessionManager::firstTokenLatency, this, [](const QString& memoryId, qint64 ms, bool http2) {
+        qDebug() << "NER首字延迟:" << ms << "ms, memoryId:" << memoryId << (http2 ? "HTTP/2" : "HTTP/1.1");
+    });
+    // 启动即预连接NER后端（NER_BASE_URL），首个请求免去TCP/TLS握手
+    const QString nerBaseUrl = qEnvironmentVariable("NER_BASE_URL");
+    if (!nerBaseUrl.isEmpty()) {
+        nerSessions->setWarmupUrl(QUrl(nerBaseUrl));
+    }
     llmTypingTimer = new QTimer(this);
     llmTypingTimer->setInterval(30); // 20–40ms 之间
-    llmCharsPerTick = 3;
+    llmTargetLatencyMs = 500;
+    llmFinalDrainMs = 300;
+    llmConsumedChars = 0;
+    llmCharCredit = 0.0;
+    llmClock.start();
     llmStreamFinished = false;
     connect(this, &Widget::llmTokens, this, &Widget::onLlmTokens);
     connect(this, &Widget::asrText, this, &Widget::updateAsrText);
@@ -96,17 +138,13 @@ Widget::Widget(QWidget *parent)
     currentSearchingFrame = 0;
     isSearchingActive = false;
     connect(searchingAnimationTimer, &QTimer::timeout, this, &Widget::onSearchingAnimationTimeout);
-    
-    // 加载searching图片资源
-    searchingPixmaps[0] = QPixmap(faceRes("searching/1.png"));
-    searchingPixmaps[1] = QPixmap(faceRes("searching/2.png"));
-    searchingPixmaps[2] = QPixmap(faceRes("searching/3.png"));
-    searchingPixmaps[3] = QPixmap(faceRes("searching/4.png"));
 }
 
 Widget::~Widget()
 {
     cleanupAnimations();
+    // 先停止网络线程，避免析构过程中仍有排队消息投递
+    stopSocketServer();
     // 新增：HTTP流式资源清理
     if (llmTypingTimer) {
         llmTypingTimer->stop();
@@ -116,12 +154,7 @@ Widget::~Widget()
     if (searchingAnimationTimer) {
         searchingAnimationTimer->stop();
     }
-    if (nerReply) {
-        disconnect(nerReply, nullptr, this, nullptr);
-        nerReply->abort();
-        nerReply->deleteLater();
-        nerReply = nullptr;
-    }
+    nerSessions->cancelAll();
     delete ui;
 }
 
@@ -140,20 +173,15 @@ void Widget::setupFaceDisplay()
     QGridLayout *root = new QGridLayout(this);
     root->setContentsMargins(0, 0, 0, 0);
     root->setSpacing(0);
-    faceLabel = new QLabel("", this);
-    faceLabel->setAlignment(Qt::AlignCenter);
-    QPixmap bgPixmap(faceRes("normal.png"));
-    if (!bgPixmap.isNull()) {
-        faceLabel->setPixmap(bgPixmap);
-        faceLabel->setScaledContents(true);
-    }
-    faceLabel->setStyleSheet("QLabel { background-color: transparent; }");
-    faceLabel->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
+    faceCanvas = new FaceCanvas(this);
+    // 资源解码完成前先显示廉价的占位脸，首帧时间不再依赖PNG解码速度
+    faceCanvas->setFrame(makePlaceholderFace());
+    // 画布尺寸变化时重建预缩放缓存
+    connect(faceCanvas, &FaceCanvas::canvasResized, this, &Widget::onFaceCanvasResized);
 
-    // ======== 眨眼资源加载 ========
-    openPixmap = QPixmap(faceRes("normal.png"));
-    transitionPixmap = QPixmap(faceRes("transition.png"));
-    closedPixmap = QPixmap(faceRes("closed.png"));
+    // 眨眼/切换动画统一由单定时器时间线驱动
+    frameTimeline = new FrameTimeline(this);
+    connect(frameTimeline, &FrameTimeline::frameChanged, faceCanvas, &FaceCanvas::setFrame);
 
     // 初始化眨眼定时器
     blinkTimer = new QTimer(this);
@@ -175,83 +203,62 @@ void Widget::setupFaceDisplay()
     bigFont.setPointSize(18);
 
     // ASR 前缀+文本框一行布局
+    // 图标在资源加载完成后填充，先固定尺寸避免布局跳动
     asrLabel = new QLabel(this);
-    QPixmap userIcon(faceRes("user_icon.png"));
-    if (!userIcon.isNull()) {
-        userIcon = userIcon.scaled(32, 32, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        asrLabel->setPixmap(userIcon);
-        asrLabel->setFixedSize(userIcon.size());
-    }
+    asrLabel->setFixedSize(32, 32);
 
-    asrEdit = new QPlainTextEdit(this);
-    asrEdit->setReadOnly(true);
-    asrEdit->setFont(bigFont);
-    asrEdit->setLineWrapMode(QPlainTextEdit::WidgetWidth);
-    asrEdit->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    asrEdit->setStyleSheet("QPlainTextEdit { background: transparent; border: none; padding: 0px; color: #ffffff; }");
-    {
-        QFontMetrics fm(asrEdit->font());
-        const int lineH = fm.lineSpacing();
-        const int frame = asrEdit->frameWidth();
-        const int padding = 0;
-        const int extra = 4; // 额外高度，让单行框稍高一点，避免文字贴边
-        asrEdit->setFixedHeight(lineH + frame * 2 + padding + extra);
-    }
-    asrEdit->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    QPalette overlayPalette = palette();
+    overlayPalette.setColor(QPalette::WindowText, Qt::white);
+
+    asrView = new OverlayTextView(this);
+    asrView->setFont(bigFont);
+    asrView->setPalette(overlayPalette);
+    asrView->setContentsMargins(0, 2, 0, 2); // 额外高度，让单行框稍高一点，避免文字贴边
+    asrView->setVisibleLines(1);
 
     // 显示固定文本
-    asrEdit->setPlainText(QStringLiteral("今天我有没有吃999感冒灵？我有点感冒"));
+    asrView->setText(QStringLiteral("今天我有没有吃999感冒灵？我有点感冒"));
 
     QHBoxLayout* asrRow = new QHBoxLayout();
     asrRow->setContentsMargins(0,0,0,0);
     asrRow->setSpacing(0);
     // 标签顶部对齐，保持与文本框首行对齐
     asrRow->addWidget(asrLabel, 0, Qt::AlignTop);
-    asrRow->addWidget(asrEdit, 1, Qt::AlignTop);
+    asrRow->addWidget(asrView, 1, Qt::AlignTop);
     streamLayout->addLayout(asrRow);
 
     // LLM 前缀+文本框三行布局
     llmPrefixLabel = new QLabel(this);
-    QPixmap robotIcon(faceRes("robot_icon.png"));
-    if (!robotIcon.isNull()) {
-        robotIcon = robotIcon.scaled(32, 32, Qt::KeepAspectRatio, Qt::SmoothTransformation);
-        llmPrefixLabel->setPixmap(robotIcon);
-        llmPrefixLabel->setFixedSize(robotIcon.size());
-    }
+    llmPrefixLabel->setFixedSize(32, 32);
 
-    llmEdit = new QPlainTextEdit(this);
-    llmEdit->setReadOnly(true);
-    llmEdit->setFont(bigFont);
-    llmEdit->setLineWrapMode(QPlainTextEdit::WidgetWidth);
-    llmEdit->setVerticalScrollBarPolicy(Qt::ScrollBarAsNeeded);
-    llmEdit->setStyleSheet("QPlainTextEdit { background: transparent; border: none; padding: 0px; color: #ffffff; }");
-    {
-        QFontMetrics fm(llmEdit->font());
-        const int lineH = fm.lineSpacing();
-        const int frame = llmEdit->frameWidth();
-        const int padding = 0; 
-        llmEdit->setFixedHeight(lineH * 3 + frame * 3 + padding);
-    }
-    llmEdit->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Fixed);
+    llmView = new OverlayTextView(this);
+    llmView->setFont(bigFont);
+    llmView->setPalette(overlayPalette);
+    llmView->setVisibleLines(3);
+    // 滚出可见区域的行只保留少量，逐字追加时文本规模恒定
+    llmView->setScrollbackLines(12);
 
     // 显示固定文本
-    llmEdit->setPlainText(QStringLiteral("根据现有资料，阿司匹林与999感冒灵不建议同时服用，主要原因包括以下几点：\n阿司匹林是一种非甾体抗炎药（NSAID），而999感冒灵中含有对乙酰氨基酚（扑热息痛），两者均为解热镇痛药。若同时使用，可能导致同类药物过量，加重肝脏和肾脏的代谢负担，甚至引发肝损伤或肾毒性。\n副作用叠加，胃肠道和中枢神经系统风险增加\n阿司匹林对胃黏膜有刺激作用，可能引起胃痛、胃溃疡甚至出血；而999感冒灵中的马来酸氯苯那敏（一种抗组胺药）可能引起嗜睡、口干等中枢抑制反应。两者合用可能放大副作用，尤其对老年人或有基础疾病者不利。"));
+    llmView->setText(QStringLiteral("根据现有资料，阿司匹林与999感冒灵不建议同时服用，主要原因包括以下几点：\n阿司匹林是一种非甾体抗炎药（NSAID），而999感冒灵中含有对乙酰氨基酚（扑热息痛），两者均为解热镇痛药。若同时使用，可能导致同类药物过量，加重肝脏和肾脏的代谢负担，甚至引发肝损伤或肾毒性。\n副作用叠加，胃肠道和中枢神经系统风险增加\n阿司匹林对胃黏膜有刺激作用，可能引起胃痛、胃溃疡甚至出血；而999感冒灵中的马来酸氯苯那敏（一种抗组胺药）可能引起嗜睡、口干等中枢抑制反应。两者合用可能放大副作用，尤其对老年人或有基础疾病者不利。"));
 
     QHBoxLayout* llmRow = new QHBoxLayout();
     llmRow->setContentsMargins(0,0,0,0);
     llmRow->setSpacing(6);
     // 标签顶部对齐，保持与文本框首行对齐
     llmRow->addWidget(llmPrefixLabel, 0, Qt::AlignTop);
-    llmRow->addWidget(llmEdit,1, Qt::AlignTop);
+    llmRow->addWidget(llmView,1, Qt::AlignTop);
     streamLayout->addLayout(llmRow);
     streamLayout->addStretch(1);
 
-    // 组装布局：faceLabel 占满，streamGroup 同单元格底对齐
+    // 组装布局：faceCanvas 占满，streamGroup 同单元格底对齐
     // 让流式对话区域宽度充满底部，并保持底部对齐
-    root->addWidget(faceLabel, 0, 0);
+    root->addWidget(faceCanvas, 0, 0);
     root->addWidget(streamGroup, 0, 0, Qt::AlignBottom);
 
     setLayout(root);
+
+    // 启动后台解码（占位脸已就绪）
+    loadExpressionSources();
 }
 
 // 图像序列相关函数实现
@@ -266,20 +273,219 @@ QString Widget::expressionTypeToString(ExpressionType type)
         default:                       return "Normal";
     }
 }
+// ========= 表情资源缓存 =========
+void Widget::loadExpressionSources()
+{
+    QHash<QString, QString> files;
+    const ExpressionType types[] = { ExpressionType::Normal, ExpressionType::Happy, ExpressionType::Sad,
+                                     ExpressionType::Warning, ExpressionType::Sleep };
+    for (ExpressionType type : types) {
+        files.insert(expressionAssetFile(type), faceRes(expressionAssetFile(type)));
+    }
+    QStringList extras = { "user_icon.png", "robot_icon.png" };
+    // 打包图集能映射打开的帧序列直接读取，不再交给PNG解码；图集缺失或损坏时回退到PNG
+    if (!openAtlas(blinkAtlas, atlasDir().filePath("blink.fatlas"), 2)) {
+        extras << "transition.png" << "closed.png";
+    }
+    if (!openAtlas(searchingAtlas, atlasDir().filePath("searching.fatlas"), 4)) {
+        extras << "searching/1.png" << "searching/2.png" << "searching/3.png" << "searching/4.png";
+    }
+    for (const QString& file : extras) {
+        files.insert(file, faceRes(file));
+    }
+
+    if (!assetLoader) {
+        assetLoader = new FaceAssetLoader(this);
+        connect(assetLoader, &FaceAssetLoader::assetsReady, this, &Widget::onFaceAssetsReady);
+    }
+    assetLoader->load(files);
+}
+
+QPixmap Widget::makePlaceholderFace() const
+{
+    // 与正式表情同比例的小图：黑底+两只圆角矩形眼睛，绘制成本可忽略
+    QPixmap pix(250, 141);
+    pix.fill(Qt::black);
+    QPainter p(&pix);
+    p.setRenderHint(QPainter::Antialiasing);
+    p.setPen(Qt::NoPen);
+    p.setBrush(Qt::white);
+    p.drawRoundedRect(QRectF(70, 45, 30, 50), 12, 12);
+    p.drawRoundedRect(QRectF(150, 45, 30, 50), 12, 12);
+    return pix;
+}
+
+void Widget::onFaceAssetsReady()
+{
+    auto pixmapOf = [this](const QString& key) {
+        return QPixmap::fromImage(assetLoader->image(key));
+    };
+
+    const ExpressionType types[] = { ExpressionType::Normal, ExpressionType::Happy, ExpressionType::Sad,
+                                     ExpressionType::Warning, ExpressionType::Sleep };
+    expressionSourcePixmaps.clear();
+    for (ExpressionType type : types) {
+        const QPixmap pix = pixmapOf(expressionAssetFile(type));
+        if (pix.isNull()) {
+            qDebug() << "[表情缓存] 资源加载失败:" << expressionAssetFile(type);
+            continue;
+        }
+        expressionSourcePixmaps.insert(type, pix);
+    }
+
+    // ======== 眨眼资源 ========
+    // 打包图集优先（已在 loadExpressionSources() 中打开）：源帧即常驻映射内存的切片，不拷贝，缩放时直接读取
+    openPixmap = expressionSourcePixmaps.value(ExpressionType::Normal);
+    if (blinkAtlas.isOpen()) {
+        transitionImage = blinkAtlas.frame(0);
+        closedImage = blinkAtlas.frame(1);
+    } else {
+        transitionImage = assetLoader->image("transition.png");
+        closedImage = assetLoader->image("closed.png");
+    }
+
+    // searching图片资源
+    for (int i = 0; i < 4; ++i) {
+        searchingImages[i] = searchingAtlas.isOpen() ? searchingAtlas.frame(i)
+                                                     : assetLoader->image(QString("searching/%1.png").arg(i + 1));
+    }
+    if (transitionImage.isNull() || closedImage.isNull()) {
+        qDebug() << "[表情缓存] 眨眼资源加载失败，眨眼将不可用";
+    }
+    for (int i = 0; i < 4; ++i) {
+        if (searchingImages[i].isNull()) {
+            qDebug() << "[表情缓存] searching资源加载失败: 第" << (i + 1) << "帧";
+        }
+    }
+
+    // 文本区图标
+    QPixmap userIcon = pixmapOf("user_icon.png");
+    if (!userIcon.isNull()) {
+        userIcon = userIcon.scaled(32, 32, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        asrLabel->setPixmap(userIcon);
+        asrLabel->setFixedSize(userIcon.size());
+    }
+    QPixmap robotIcon = pixmapOf("robot_icon.png");
+    if (!robotIcon.isNull()) {
+        robotIcon = robotIcon.scaled(32, 32, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+        llmPrefixLabel->setPixmap(robotIcon);
+        llmPrefixLabel->setFixedSize(robotIcon.size());
+    }
+
+    // 源图已更换：强制按当前显示尺寸重建缓存
+    expressionCacheSize = QSize();
+    if (faceCanvas->isVisible()) {
+        rebuildExpressionCache(faceCanvas->size());
+    }
+    if (expressionCacheSize.isEmpty()) {
+        // 尚未布局（窗口未显示），先以原图填充，首次resize时再缩放
+        expressionPixmapCache = expressionSourcePixmaps;
+        blinkTransitionFrame = QPixmap::fromImage(transitionImage);
+        blinkClosedFrame = QPixmap::fromImage(closedImage);
+        for (int i = 0; i < 4; ++i) {
+            searchingFrames[i] = QPixmap::fromImage(searchingImages[i]);
+        }
+    }
+
+    if (!isSearchingActive) {
+        const QPixmap pix = expressionPixmapCache.value(currentExpression);
+        if (!pix.isNull()) {
+            faceCanvas->setFrame(pix);
+        }
+    }
+    Q_EMIT assetsReady();
+}
+
+QPixmap Widget::scaledToFace(const QPixmap& source) const
+{
+    if (source.isNull() || expressionCacheSize.isEmpty()) {
+        return source;
+    }
+    // 与原先setScaledContents(true)的观感一致：忽略宽高比铺满画布。
+    // 同时把透明区域压平到窗口底色上，画布绘制时只需不透明拷贝，无需逐像素混合
+    const qreal dpr = devicePixelRatioF();
+    const QSize target = expressionCacheSize * dpr;
+    QPixmap scaled = source.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    if (scaled.hasAlphaChannel()) {
+        QPixmap opaque(target);
+        opaque.fill(palette().color(QPalette::Window));
+        QPainter p(&opaque);
+        p.drawPixmap(0, 0, scaled);
+        p.end();
+        scaled = opaque;
+    }
+    scaled.setDevicePixelRatio(dpr);
+    return scaled;
+}
+
+QPixmap Widget::scaledToFace(const QImage& source) const
+{
+    if (source.isNull() || expressionCacheSize.isEmpty()) {
+        return QPixmap::fromImage(source);
+    }
+    // 直接从源像素（可能是图集映射内存）缩放，只生成缩放结果这一份拷贝
+    const qreal dpr = devicePixelRatioF();
+    const QSize target = expressionCacheSize * dpr;
+    QImage scaled = source.scaled(target, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    if (scaled.hasAlphaChannel()) {
+        QImage opaque(target, QImage::Format_RGB32);
+        opaque.fill(palette().color(QPalette::Window));
+        QPainter p(&opaque);
+        p.drawImage(0, 0, scaled);
+        p.end();
+        scaled = opaque;
+    }
+    QPixmap pix = QPixmap::fromImage(std::move(scaled));
+    pix.setDevicePixelRatio(dpr);
+    return pix;
+}
+
+void Widget::rebuildExpressionCache(const QSize& size)
+{
+    if (size.isEmpty() || size == expressionCacheSize) {
+        return;
+    }
+    expressionCacheSize = size;
+    // 已缓存的插值序列按旧尺寸缩放，整体失效，下次使用时重新加载
+    clearImageSequenceCache();
+
+    expressionPixmapCache.clear();
+    for (auto it = expressionSourcePixmaps.cbegin(); it != expressionSourcePixmaps.cend(); ++it) {
+        expressionPixmapCache.insert(it.key(), scaledToFace(it.value()));
+    }
+    blinkTransitionFrame = scaledToFace(transitionImage);
+    blinkClosedFrame = scaledToFace(closedImage);
+    for (int i = 0; i < 4; ++i) {
+        searchingFrames[i] = scaledToFace(searchingImages[i]);
+    }
+    precomputeFaceDirtyRects();
+    qDebug() << "[表情缓存] 已按显示尺寸重建:" << size;
+}
+
+void Widget::precomputeFaceDirtyRects()
+{
+    // 只登记会反复切换的固定帧对：表情互切/淡化、眨眼、searching循环
+    QList<QPair<QPixmap, QPixmap>> pairs;
+    const QList<QPixmap> expressions = expressionPixmapCache.values();
+    for (int i = 0; i < expressions.size(); ++i) {
+        pairs.append(qMakePair(expressions.at(i), blinkTransitionFrame));
+        for (int j = i + 1; j < expressions.size(); ++j) {
+            pairs.append(qMakePair(expressions.at(i), expressions.at(j)));
+        }
+    }
+    pairs.append(qMakePair(blinkTransitionFrame, blinkClosedFrame));
+    for (int i = 0; i < 4; ++i) {
+        pairs.append(qMakePair(searchingFrames[i], searchingFrames[(i + 1) % 4]));
+    }
+    faceCanvas->precomputeDirtyRects(pairs);
+}
+
 // ========= 新增：根据表达类型设置背景 =========
 void Widget::setExpressionBackground(ExpressionType type)
 {
-    QString path;
-    switch(type){
-        case ExpressionType::Happy:    path = faceRes("emotion_happy.png"); break;
-        case ExpressionType::Sad:      path = faceRes("emotion_sad.png"); break;
-        case ExpressionType::Warning:  path = faceRes("emotion_warning.png"); break;
-        case ExpressionType::Sleep:    path = faceRes("sleep.png"); break;
-        default: /* Normal */          path = faceRes("normal.png"); break;
-    }
-    QPixmap pix(path);
+    const QPixmap pix = expressionPixmapCache.value(type);
     if(!pix.isNull()){
-        faceLabel->setPixmap(pix);
+        faceCanvas->setFrame(pix);
     }
 
     // 更新当前表情状态
@@ -341,9 +547,8 @@ void Widget::processEmotionOutput(const EmotionOutput& emotionData)
     currentEmotionOutput = emotionData;
     
     // 切换到目标表情
-    // 眨眼动画结束后再切换表情，确保顺序：①眨眼②切换表情
-    blinkOnceAsChangeExpression([this, targetType]() {
-        setExpressionBackground(targetType);
+    // 过渡动画（插值序列或眨眼）结束后再切换表情，确保顺序：①过渡②切换表情
+    transitionToExpression(targetType, [this]() {
         // 重新计时空闲定时器
         resetIdleTimer();
     });
@@ -408,20 +613,18 @@ void Widget::onExpressionDurationTimeout()
 {
     ExpressionType restoreType = ExpressionType::Normal;
     qDebug() << "[表情切换] 持续时间结束，恢复到:" << expressionTypeToString(restoreType);
-    // 恢复表情时先眨眼，眨眼动画结束后再恢复表情
-    blinkOnceAsChangeExpression([this, restoreType]() {
-        setExpressionBackground(restoreType);
-    });
+    // 恢复表情时先过渡，过渡动画结束后再恢复表情
+    transitionToExpression(restoreType);
 }
 
 // ==================== Socket服务器相关函数实现 ====================
 
 void Widget::initializeSocketServer()
 {
-    tcpServer = new QTcpServer(this);
-    
-    // 连接服务器信号
-    connect(tcpServer, &QTcpServer::newConnection, this, &Widget::onNewConnection);
+    // 网络I/O线程：QTcpServer与客户端socket均在该线程中创建和读取，
+    // 解析后的消息经排队信号回到GUI线程，token洪峰不再挤占动画帧
+    socketThread = new QThread(this);
+    socketThread->setObjectName("SocketServerThread");
     
     // 自动启动服务器
     startSocketServer(serverPort);
@@ -431,160 +634,74 @@ void Widget::initializeSocketServer()
 
 void Widget::startSocketServer(quint16 port)
 {
-    if (isServerRunning) {
+    if (socketWorker) {
         qDebug() << "[Socket服务器] 服务器已在运行，端口:" << serverPort;
         return;
     }
     
     serverPort = port;
+    socketWorker = new SocketServerWorker(serverPort, llmIngest);
+    socketWorker->moveToThread(socketThread);
     
-    if (tcpServer->listen(QHostAddress::Any, serverPort)) {
-        isServerRunning = true;
-        QString localIP = getLocalIPAddress();
-        qDebug() << "[Socket服务器] 启动成功";
-        qDebug() << "[Socket服务器] 监听地址:" << localIP << ":" << serverPort;
-        qDebug() << "[Socket服务器] Python客户端可连接到:" << localIP << ":" << serverPort;
-    } else {
-        qDebug() << "[Socket服务器] 启动失败:" << tcpServer->errorString();
-        isServerRunning = false;
-    }
+    connect(socketThread, &QThread::started, socketWorker, &SocketServerWorker::start);
+    connect(socketThread, &QThread::finished, socketWorker, &QObject::deleteLater);
+    connect(socketWorker, &SocketServerWorker::serverStateChanged, this, &Widget::onSocketServerStateChanged);
+    connect(socketWorker, &SocketServerWorker::asrReceived, this, &Widget::onSocketAsr);
+    connect(socketWorker, &SocketServerWorker::emotionReceived, this, &Widget::onSocketEmotion);
+    // 背压状态变化（无论来自socket还是HTTP积压）都让网络线程暂停/恢复读取
+    connect(llmIngest, &LlmIngestQueue::backpressureChanged, socketWorker, &SocketServerWorker::setReadPaused);
+    
+    socketThread->start();
 }
 
 void Widget::stopSocketServer()
 {
-    if (!isServerRunning) {
+    if (!socketWorker) {
         return;
     }
     
-    // 断开所有客户端连接
-    for (QTcpSocket* socket : clientSockets) {
-        socket->disconnectFromHost();
-        socket->deleteLater();
-    }
-    clientSockets.clear();
-    
-    // 停止服务器监听
-    tcpServer->close();
+    // 在网络线程内关闭监听与全部连接，再结束线程（worker随线程结束释放）
+    QMetaObject::invokeMethod(socketWorker, "stop", Qt::BlockingQueuedConnection);
+    socketThread->quit();
+    socketThread->wait();
+    socketWorker = nullptr;
     isServerRunning = false;
-    
-    qDebug() << "[Socket服务器] 已停止";
 }
 
-void Widget::onNewConnection()
+void Widget::onSocketServerStateChanged(bool running, quint16 port)
 {
-    while (tcpServer->hasPendingConnections()) {
-        QTcpSocket* clientSocket = tcpServer->nextPendingConnection();
-        clientSockets.append(clientSocket);
-        
-        // 连接客户端信号
-        connect(clientSocket, &QTcpSocket::readyRead, this, &Widget::onDataReceived);
-        connect(clientSocket, &QTcpSocket::disconnected, this, &Widget::onClientDisconnected);
-        connect(clientSocket, QOverload<QAbstractSocket::SocketError>::of(&QAbstractSocket::error),
-                this, &Widget::onSocketError);
-        
-        QString clientIP = clientSocket->peerAddress().toString();
-        quint16 clientPort = clientSocket->peerPort();
-        
-        qDebug() << "[Socket服务器] 新客户端连接:" << clientIP << ":" << clientPort;
-        qDebug() << "[Socket服务器] 当前连接数:" << clientSockets.size();
-    }
+    isServerRunning = running;
+    serverPort = port;
 }
 
-void Widget::onClientDisconnected()
+void Widget::onSocketAsr(const QString& text, bool isFinal)
 {
-    QTcpSocket* clientSocket = qobject_cast<QTcpSocket*>(sender());
-    if (clientSocket) {
-        QString clientIP = clientSocket->peerAddress().toString();
-        quint16 clientPort = clientSocket->peerPort();
-        
-        clientSockets.removeAll(clientSocket);
-        clientSocket->deleteLater();
-        
-        qDebug() << "[Socket服务器] 客户端断开连接:" << clientIP << ":" << clientPort;
-        qDebug() << "[Socket服务器] 当前连接数:" << clientSockets.size();
-    }
+    Q_EMIT asrText(text, isFinal);
 }
 
-void Widget::onDataReceived()
+void Widget::onSocketEmotion(const QString& emotion)
 {
-    QTcpSocket* clientSocket = qobject_cast<QTcpSocket*>(sender());
-    if (!clientSocket) {
-        return;
-    }
-    
-    QByteArray data = clientSocket->readAll();
-    QString clientIP = clientSocket->peerAddress().toString();
-    
-    qDebug() << "[Socket服务器] 收到数据来自" << clientIP << ":" << data;
-    
-    // 处理接收到的数据
-    processSocketData(data);
-}
-
-void Widget::onSocketError(QAbstractSocket::SocketError error)
-{
-    QTcpSocket* clientSocket = qobject_cast<QTcpSocket*>(sender());
-    if (clientSocket) {
-        QString clientIP = clientSocket->peerAddress().toString();
-        qDebug() << "[Socket服务器] 客户端错误" << clientIP << ":" << error << clientSocket->errorString();
-    }
+    // Java端发送的emotion字段（新格式）；文本经llmIngest合并后投递
+    processJavaEmotion(emotion);
 }
 
-void Widget::processSocketData(const QByteArray& data)
+void Widget::onLlmIngestAvailable()
 {
-    QString jsonString = QString::fromUtf8(data).trimmed();
-    
-    // 处理可能的多行JSON数据
-    QStringList jsonLines = jsonString.split('\n', QString::SkipEmptyParts);
-    
-    for (const QString& line : jsonLines) {
-        QString trimmedLine = line.trimmed();
-        if (trimmedLine.isEmpty()) {
-            continue;
-        }
-        
-        // 优先尝试解析ASR/LLM流式协议
-        QJsonParseError perr;
-        QJsonDocument doc = QJsonDocument::fromJson(trimmedLine.toUtf8(), &perr);
-        if (perr.error == QJsonParseError::NoError && doc.isObject()) {
-            QJsonObject obj = doc.object();
-            const QString type = obj.value("type").toString();
-            if (type == "asr") {
-                const QString text = obj.value("text").toString();
-                const bool isFinal = obj.value("isFinal").toBool(false) || obj.value("is_final").toBool(false);
-                Q_EMIT asrText(text, isFinal);
-                continue;
-            }
-            if (type == "llm_stream") {
-                const QString text = obj.value("text").toString();
-                const bool isFinal = obj.value("isFinal").toBool(false) || obj.value("is_final").toBool(false);
-                
-                // 检查是否包含Java端发送的emotion字段（新格式）
-                if (obj.contains("emotion") && !obj.value("emotion").toString().isEmpty()) {
-                    const QString emotion = obj.value("emotion").toString();
-                    processJavaEmotion(emotion);
-                }
-                
-                Q_EMIT llmTokens(text, isFinal);
-                continue;
-            }
-        }
-        
-        // 其他格式的JSON数据暂不处理（旧的emotion_output格式已废弃）
-        qDebug() << "[Socket数据处理] 未识别的JSON格式，忽略:" << trimmedLine;
+    // 每轮事件循环把已合并的token一次性交给打字显示（段在isFinal处切分）
+    QString text;
+    bool isFinal = false;
+    LlmIngestQueue::Source source = LlmIngestQueue::SocketSource;
+    while (llmIngest->take(&text, &isFinal, &source)) {
+        appendLlmTokens(text, isFinal, source);
     }
 }
 
-QString Widget::getLocalIPAddress()
+void Widget::onLlmBackpressureChanged(bool paused)
 {
-    // 获取本机IP地址
-    QList<QHostAddress> addresses = QNetworkInterface::allAddresses();
-    for (const QHostAddress &addr : addresses) {
-        if (addr.protocol() == QAbstractSocket::IPv4Protocol && addr != QHostAddress::LocalHost) {
-            return addr.toString();
-        }
+    // 恢复时读取HTTP回复中暂存的数据（暂停期间readyRead已被忽略）
+    if (!paused) {
+        nerSessions->resumeDisplayed();
     }
-    return QHostAddress(QHostAddress::LocalHost).toString();
 }
 
 void Widget::processJavaEmotion(const QString& emotion)
@@ -615,9 +732,8 @@ void Widget::processJavaEmotion(const QString& emotion)
         stopSearchingAnimation();
     }
     
-    // 眨眼动画结束后切换表情
-    blinkOnceAsChangeExpression([this, targetType]() {
-        setExpressionBackground(targetType);
+    // 过渡动画结束后切换表情
+    transitionToExpression(targetType, [this]() {
         resetIdleTimer();
     });
 }
@@ -625,136 +741,92 @@ void Widget::processJavaEmotion(const QString& emotion)
 // =================== 新增：HTTP流式方法与显示逻辑 ===================
 void Widget::startNerStreamJson(const QUrl& baseUrl, const QString& memoryId, const QString& text)
 {
-    if (nerReply) {
-        disconnect(nerReply, nullptr, this, nullptr);
-        nerReply->abort();
-        nerReply->deleteLater();
-        nerReply = nullptr;
-    }
-    llmPending.clear();
-    llmDisplayed.clear();
-    llmStreamFinished = false;
-    updateLlmDisplay();
-
-    QUrl url(baseUrl);
-    QString path = url.path();
-    if (!path.endsWith('/')) path += '/';
-    path += "ner";
-    url.setPath(path);
-    QUrlQuery query(url);
-    query.addQueryItem("memoryId", memoryId);
-    url.setQuery(query);
-
-    QNetworkRequest req(url);
-    req.setHeader(QNetworkRequest::ContentTypeHeader, QString("application/json"));
-
     QJsonObject body;
     body.insert("text", text);
-    QJsonDocument doc(body);
-
-    nerReply = nerNam->post(req, doc.toJson(QJsonDocument::Compact));
-    connect(nerReply, &QNetworkReply::readyRead, this, &Widget::onNerReadyRead);
-    connect(nerReply, &QNetworkReply::finished, this, &Widget::onNerFinished);
-#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-    connect(nerReply, &QNetworkReply::errorOccurred, this, &Widget::onNerError);
-#else
-    connect(nerReply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), this, &Widget::onNerError);
-#endif
+    nerSessions->startJson(baseUrl, memoryId, QJsonDocument(body).toJson(QJsonDocument::Compact), true);
 }
 
 void Widget::startNerStreamMultipart(const QUrl& baseUrl, const QString& memoryId, const QString& imagePath)
 {
-    if (nerReply) {
-        disconnect(nerReply, nullptr, this, nullptr);
-        nerReply->abort();
-        nerReply->deleteLater();
-        nerReply = nullptr;
-    }
-    llmPending.clear();
-    llmDisplayed.clear();
-    llmStreamFinished = false;
-    updateLlmDisplay();
-
-    QUrl url(baseUrl);
-    QString path = url.path();
-    if (!path.endsWith('/')) path += '/';
-    path += "ner";
-    url.setPath(path);
-    QUrlQuery query(url);
-    query.addQueryItem("memoryId", memoryId);
-    url.setQuery(query);
-
-    QNetworkRequest req(url);
-
-    QHttpMultiPart* multi = new QHttpMultiPart(QHttpMultiPart::FormDataType);
-
-    QHttpPart filePart;
-    filePart.setHeader(QNetworkRequest::ContentDispositionHeader, QVariant("form-data; name=\"imageFile\"; filename=\"upload.jpg\""));
-    QFile* file = new QFile(imagePath);
-    if (!file->open(QIODevice::ReadOnly)) {
-        delete file;
-        delete multi;
+    if (!nerSessions->startMultipart(baseUrl, memoryId, imagePath, true)) {
         Q_EMIT llmTokens(QStringLiteral("[错误] 无法打开文件: ") + imagePath + "\n", true);
-        return;
     }
-    filePart.setBodyDevice(file);
-    file->setParent(multi); // multi析构时释放
-
-    multi->append(filePart);
+}
 
-    nerReply = nerNam->post(req, multi);
-    multi->setParent(nerReply); // reply完成后释放
+void Widget::prefetchNerStreamJson(const QUrl& baseUrl, const QString& memoryId, const QString& text)
+{
+    QJsonObject body;
+    body.insert("text", text);
+    nerSessions->startJson(baseUrl, memoryId, QJsonDocument(body).toJson(QJsonDocument::Compact), false);
+}
 
-    connect(nerReply, &QNetworkReply::readyRead, this, &Widget::onNerReadyRead);
-    connect(nerReply, &QNetworkReply::finished, this, &Widget::onNerFinished);
-#if QT_VERSION >= QT_VERSION_CHECK(5, 15, 0)
-    connect(nerReply, &QNetworkReply::errorOccurred, this, &Widget::onNerError);
-#else
-    connect(nerReply, QOverload<QNetworkReply::NetworkError>::of(&QNetworkReply::error), this, &Widget::onNerError);
-#endif
+bool Widget::showNerSession(const QString& memoryId)
+{
+    return nerSessions->showSession(memoryId);
 }
 
-void Widget::onNerReadyRead()
+void Widget::setNerBaseUrl(const QUrl& baseUrl)
 {
-    if (!nerReply) return;
-    const QByteArray chunk = nerReply->readAll();
-    if (chunk.isEmpty()) return;
-    nerBuffer.append(chunk);
-    const QString text = QString::fromUtf8(chunk);
-    if (!text.isEmpty()) {
-        Q_EMIT llmTokens(text, false);
-        resetIdleTimer();
-    }
+    nerSessions->setWarmupUrl(baseUrl);
 }
 
-void Widget::onNerFinished()
+void Widget::onNerSessionShown(const QString& memoryId)
 {
-    llmStreamFinished = true;
-    Q_EMIT llmTokens(QString(), true);
-    if (nerReply) {
-        nerReply->deleteLater();
-        nerReply = nullptr;
+    Q_UNUSED(memoryId);
+    // 切换到另一会话：清空打字显示，随后回放该会话已缓存的文本。
+    // 只丢弃NER来源的文本，socket llm_stream 尚未上屏的部分保留
+    llmIngest->clear(LlmIngestQueue::NerSource);
+    QString kept;
+    int offset = 0;
+    for (const auto& run : qAsConst(llmPendingRuns)) {
+        if (run.first == LlmIngestQueue::SocketSource) {
+            kept.append(llmPending.midRef(offset, run.second));
+        }
+        offset += run.second;
     }
+    llmPending = kept;
+    llmPendingRuns.clear();
+    resetLlmPacing();
+    if (!kept.isEmpty()) {
+        llmPendingRuns.append(qMakePair(LlmIngestQueue::SocketSource, kept.size()));
+        llmDeadlines.enqueue(qMakePair(qint64(kept.size()), llmClock.elapsed() + llmTargetLatencyMs));
+    }
+    llmStreamFinished = false;
+    llmView->clear();
+    llmIngest->setConsumerBacklog(llmPending.size());
 }
 
-void Widget::onNerError(QNetworkReply::NetworkError code)
+void Widget::onLlmTokens(const QString& text, bool isFinal)
 {
-    Q_UNUSED(code);
-    const QString err = nerReply ? nerReply->errorString() : QStringLiteral("unknown error");
-    Q_EMIT llmTokens(QStringLiteral("[网络错误] ") + err + "\n", true);
+    appendLlmTokens(text, isFinal, LlmIngestQueue::SocketSource);
 }
 
-void Widget::onLlmTokens(const QString& text, bool isFinal)
+void Widget::appendLlmTokens(const QString& text, bool isFinal, LlmIngestQueue::Source source)
 {
     // 如果上一轮已结束且收到新文本，则清空显示，保证“每次只显示一次的回复”
     if (llmStreamFinished && !text.isEmpty()) {
         llmPending.clear();
-        llmDisplayed.clear();
+        llmPendingRuns.clear();
+        resetLlmPacing();
         llmStreamFinished = false;
-        updateLlmDisplay();
+        llmView->clear();
     }
     if (!text.isEmpty()) {
         llmPending.append(text);
+        if (!llmPendingRuns.isEmpty() && llmPendingRuns.last().first == source) {
+            llmPendingRuns.last().second += text.size();
+        } else {
+            llmPendingRuns.append(qMakePair(source, text.size()));
+        }
+        // 记录本批字符的显示截止时间（到达时刻 + 目标延迟）
+        const qint64 endOffset = llmConsumedChars + llmPending.size();
+        const qint64 deadline = llmClock.elapsed() + llmTargetLatencyMs;
+        if (llmDeadlines.size() >= 64) {
+            // 合并到最后一批：沿用较早的截止时间，只会更严格
+            llmDeadlines.last().first = endOffset;
+        } else {
+            llmDeadlines.enqueue(qMakePair(endOffset, deadline));
+        }
         // 第一次收到LLM文本时停止searching动画，恢复所有功能
         if (isSearchingActive) {
             stopSearchingAnimation();
@@ -762,7 +834,14 @@ void Widget::onLlmTokens(const QString& text, bool isFinal)
     }
     if (isFinal) {
         llmStreamFinished = true;
+        // 流结束：剩余积压须在 llmFinalDrainMs 内全部上屏
+        const qint64 drainBy = llmClock.elapsed() + llmFinalDrainMs;
+        for (auto &mark : llmDeadlines) {
+            mark.second = qMin(mark.second, drainBy);
+        }
     }
+    // 显示端积压参与背压水位判断
+    llmIngest->setConsumerBacklog(llmPending.size());
     if (!llmTypingTimer->isActive()) {
         llmTypingTimer->start();
     }
@@ -773,42 +852,74 @@ void Widget::onTypingTick()
     if (llmPending.isEmpty()) {
         if (llmStreamFinished) {
             llmTypingTimer->stop();
+            nerSessions->displayDrained();
         }
         return;
     }
-    const int n = qMin(llmCharsPerTick, llmPending.size());
+    int n = qMin(llmCharsForThisTick(), llmPending.size());
+    if (n <= 0) {
+        return;
+    }
+    // 速率按UTF-16单元计，切分点顺延到字素边界，避免把代理对/组合字符拆到两帧；
+    // 取出、计数与积压都用同一单位
+    if (n < llmPending.size()) {
+        // 只分析切分点附近的一小段，积压很长时也不必扫描整个缓冲
+        const int window = qMin(llmPending.size(), n + 16);
+        QTextBoundaryFinder graphemes(QTextBoundaryFinder::Grapheme, llmPending.constData(), window);
+        graphemes.setPosition(n);
+        if (!graphemes.isAtBoundary()) {
+            n = qMax(n, graphemes.toNextBoundary());
+        }
+    }
     const QString chunk = llmPending.left(n);
     llmPending.remove(0, n);
-    llmDisplayed.append(chunk);
-    updateLlmDisplay();
+    for (int left = n; left > 0 && !llmPendingRuns.isEmpty();) {
+        const int used = qMin(left, llmPendingRuns.first().second);
+        llmPendingRuns.first().second -= used;
+        left -= used;
+        if (llmPendingRuns.first().second == 0) {
+            llmPendingRuns.removeFirst();
+        }
+    }
+    llmConsumedChars += n;
+    llmIngest->setConsumerBacklog(llmPending.size());
+    llmView->appendText(chunk);
 }
 
-void Widget::updateLlmDisplay()
+int Widget::llmCharsForThisTick()
 {
-    // 框内仅显示内容，前缀在框上一行标签中
-    llmEdit->setPlainText(llmDisplayed);
-    
-    // 将光标移动到文末并确保可见，避免首次刷新不显示的问题
-    QTextCursor c = llmEdit->textCursor();
-    c.movePosition(QTextCursor::End);
-    llmEdit->setTextCursor(c);
-    llmEdit->ensureCursorVisible();
-    
-    // 在布局完成后，将滚动条滚到最底：
-    // - 当文本未超过两行时，最大值≈0，等价于正常显示；
-    // - 当文本超过两行（出现第3行）时，自动滚动到底部，仅显示最新两行；
-    QTimer::singleShot(0, this, [this]() {
-        if (auto *bar = llmEdit->verticalScrollBar()) {
-            bar->setValue(bar->maximum());
-        }
-    });
+    // 截止时间调度：每批字符须在“到达 + 目标延迟”前上屏。
+    // 取所有未完成批次所需的最大速率，积压大时自动提速，生产慢时降到小数字符/帧平滑输出。
+    while (!llmDeadlines.isEmpty() && llmDeadlines.head().first <= llmConsumedChars) {
+        llmDeadlines.dequeue();
+    }
+    const qint64 now = llmClock.elapsed();
+    const int interval = qMax(1, llmTypingTimer->interval());
+    double rate = 0.0;
+    for (const auto &mark : llmDeadlines) {
+        const qint64 chars = mark.first - llmConsumedChars;
+        // 已过期的批次视为剩余1帧，本帧全部输出
+        const qint64 ticksLeft = qMax<qint64>(1, (mark.second - now) / interval);
+        rate = qMax(rate, double(chars) / double(ticksLeft));
+    }
+    llmCharCredit += rate;
+    const int n = int(llmCharCredit);
+    llmCharCredit -= n;
+    return n;
+}
+
+void Widget::resetLlmPacing()
+{
+    llmDeadlines.clear();
+    llmConsumedChars = 0;
+    llmCharCredit = 0.0;
 }
 
 void Widget::updateAsrText(const QString& text, bool isFinal)
 {
     Q_UNUSED(isFinal);
     // 框内仅显示内容，前缀在框上一行标签中
-    asrEdit->setPlainText(text);
+    asrView->setText(text);
     
     // 删除旧的眨眼逻辑，启动searching动画
     startSearchingAnimation();
@@ -817,35 +928,257 @@ void Widget::updateAsrText(const QString& text, bool isFinal)
 // ==================== 新增：眨眼带回调实现 ====================
 void Widget::blinkOnceAsChangeExpression(const std::function<void()>& callback)
 {
-    // 在0.5秒内切换三帧
-    if (transitionPixmap.isNull() || closedPixmap.isNull()) {
+    // 在0.3秒内切换三帧
+    if (blinkTransitionFrame.isNull() || blinkClosedFrame.isNull()) {
         if (callback) callback();
         return; // 资源缺失
     }
 
-    faceLabel->setPixmap(transitionPixmap);
-    QTimer::singleShot(100, this, [this, callback]() {
-        faceLabel->setPixmap(closedPixmap);
-        QTimer::singleShot(100, this, [this, callback]() {
-            faceLabel->setPixmap(transitionPixmap);
-            QTimer::singleShot(100, this, [this, callback]() {
-                // 根据是否有回调决定是否睁眼
-                if (callback) {
-                    // 直接执行回调，不再显示睁眼帧
-                    callback();
-                } else {
-                    // 无回调时属于普通眨眼，根据当前表情恢复对应背景
-                    setExpressionBackground(currentExpression);
-                }
+    const QList<TimelineFrame> frames = {
+        TimelineFrame(blinkTransitionFrame, 100),
+        TimelineFrame(blinkClosedFrame, 100),
+        TimelineFrame(blinkTransitionFrame, 100)
+    };
+    auto finished = [this, callback]() {
+        // 根据是否有回调决定是否睁眼
+        if (callback) {
+            // 直接执行回调，不再显示睁眼帧
+            callback();
+        } else {
+            // 无回调时属于普通眨眼，根据当前表情恢复对应背景
+            setExpressionBackground(currentExpression);
+        }
 
-                // 重新启动随机眨眼（仅当当前表情允许眨眼）
-                if (blinkTimer && currentExpression != ExpressionType::Sleep && currentExpression != ExpressionType::Warning) {
-                    blinkTimer->start(randomBlinkIntervalMs());
-                }
-            });
-        });
+        // 重新启动随机眨眼（仅当当前表情允许眨眼）
+        if (blinkTimer && currentExpression != ExpressionType::Sleep && currentExpression != ExpressionType::Warning) {
+            blinkTimer->start(randomBlinkIntervalMs());
+        }
+    };
+
+    if (callback) {
+        playTransitionFrames(frames, finished);
+    } else {
+        // 普通眨眼：已有序列在播放时不再叠加
+        if (frameTimeline->isBusy()) {
+            return;
+        }
+        frameTimeline->play(QStringLiteral("blink"), frames, finished, FrameTimeline::Policy::Replace);
+    }
+}
+void Widget::playTransitionFrames(const QList<TimelineFrame>& frames, const std::function<void()>& finished)
+{
+    // 表情切换：打断普通眨眼；已有切换在播放时合并，只保留最新目标的回调
+    const FrameTimeline::Policy policy = frameTimeline->activeKind() == QLatin1String("blink")
+            ? FrameTimeline::Policy::Replace
+            : FrameTimeline::Policy::Coalesce;
+    frameTimeline->play(QStringLiteral("transition"), frames, finished, policy);
+}
+
+// ==================== 插值图像序列 ====================
+QDir Widget::interpolationDir() const
+{
+    if (QDir::isRelativePath(interpolationBasePath)) {
+        return QDir(QDir(QCoreApplication::applicationDirPath()).filePath(interpolationBasePath));
+    }
+    return QDir(interpolationBasePath);
+}
+
+QDir Widget::atlasDir() const
+{
+    if (QDir::isRelativePath(atlasBasePath)) {
+        return QDir(QDir(QCoreApplication::applicationDirPath()).filePath(atlasBasePath));
+    }
+    return QDir(atlasBasePath);
+}
+
+bool Widget::openAtlas(FaceAtlas& atlas, const QString& path, int minFrames)
+{
+    atlas.close();
+    if (!QFile::exists(path)) {
+        return false;
+    }
+    if (!atlas.open(path)) {
+        qDebug() << "[图集] 打开失败，改用PNG:" << path;
+        return false;
+    }
+    if (atlas.frameCount() < minFrames) {
+        qDebug() << "[图集] 帧数不足，改用PNG:" << path << atlas.frameCount() << "<" << minFrames;
+        atlas.close();
+        return false;
+    }
+    qDebug() << "[图集] 已映射:" << path << "帧数:" << atlas.frameCount();
+    return true;
+}
+
+void Widget::transitionToExpression(ExpressionType target, const std::function<void()>& after)
+{
+    auto finished = [this, target, after]() {
+        setExpressionBackground(target);
+        if (after) after();
+        // 非Normal表情大概率会恢复为Normal，提前准备回程序列
+        if (useImageSequences && target != ExpressionType::Normal) {
+            preloadImageSequence(expressionTypeToString(target) + "_to_" + expressionTypeToString(ExpressionType::Normal));
+        }
+    };
+
+    if (useImageSequences && target != currentExpression && !isSearchingActive) {
+        const QString name = expressionTypeToString(currentExpression) + "_to_" + expressionTypeToString(target);
+        const QList<QPixmap> sequence = cachedImageSequence(name);
+        if (!sequence.isEmpty()) {
+            QList<TimelineFrame> frames;
+            for (const QPixmap& pix : sequence) {
+                frames.append(TimelineFrame(pix, imageAnimationIntervalMs));
+            }
+            playTransitionFrames(frames, finished);
+            return;
+        }
+        // 序列尚未解码：本次以淡化或眨眼过渡，不阻塞等待
+        preloadImageSequence(name);
+    }
+    if (useCrossFade && target != currentExpression && !isSearchingActive && playCrossFade(target, finished)) {
+        return;
+    }
+    blinkOnceAsChangeExpression(finished);
+}
+
+bool Widget::playCrossFade(ExpressionType target, const std::function<void()>& finished)
+{
+    const QPixmap from = expressionPixmapCache.value(currentExpression);
+    const QPixmap to = expressionPixmapCache.value(target);
+    if (from.isNull() || to.isNull() || from.size() != to.size()) {
+        return false;
+    }
+
+    // 每帧在画布绘制时实时混合，不生成任何中间图像
+    const int steps = qMax(1, crossFadeDurationMs / qMax(1, imageAnimationIntervalMs));
+    QList<TimelineFrame> frames;
+    for (int i = 1; i <= steps; ++i) {
+        const qreal progress = crossFadeEasing.valueForProgress(qreal(i) / steps);
+        frames.append(TimelineFrame([this, from, to, progress]() {
+            faceCanvas->setCrossFade(from, to, progress);
+        }, imageAnimationIntervalMs));
+    }
+    playTransitionFrames(frames, finished);
+    return true;
+}
+
+void Widget::preloadImageSequence(const QString& sequenceName)
+{
+    if (!useImageSequences || imageSequenceCache.contains(sequenceName)
+        || imageSequenceLoaders.contains(sequenceName) || missingImageSequences.contains(sequenceName)) {
+        return;
+    }
+
+    // 优先使用打包图集 X_to_Y.fatlas：映射与缩放都在工作线程，无需PNG解码
+    const QString atlasPath = interpolationDir().filePath(sequenceName + ".fatlas");
+    if (QFile::exists(atlasPath)) {
+        startImageSequenceLoad(sequenceName, atlasPath, QHash<QString, QString>());
+        return;
+    }
+    startPngSequenceLoad(sequenceName);
+}
+
+bool Widget::startPngSequenceLoad(const QString& sequenceName)
+{
+    const QDir dir(interpolationDir().filePath(sequenceName));
+    const QStringList files = dir.entryList(QStringList() << "frame_*.png", QDir::Files, QDir::Name);
+    if (files.isEmpty()) {
+        missingImageSequences.insert(sequenceName);
+        qDebug() << "[图像序列] 未找到序列:" << sequenceName;
+        return false;
+    }
+
+    QHash<QString, QString> entries;
+    for (const QString& file : files) {
+        entries.insert(file, dir.filePath(file));
+    }
+    startImageSequenceLoad(sequenceName, QString(), entries);
+    return true;
+}
+
+void Widget::startImageSequenceLoad(const QString& sequenceName, const QString& atlasPath,
+                                    const QHash<QString, QString>& entries)
+{
+    // 在工作线程内解码（或读图集）并缩放到画布尺寸，GUI线程只做QPixmap转换
+    FaceAssetLoader* loader = new FaceAssetLoader(this);
+    imageSequenceLoaders.insert(sequenceName, loader);
+    connect(loader, &FaceAssetLoader::assetsReady, this, [this, sequenceName, atlasPath, loader]() {
+        imageSequenceLoaders.remove(sequenceName);
+        loader->deleteLater();
+        const QSize deviceSize = expressionCacheSize * devicePixelRatioF();
+        if (loader->targetSize() != deviceSize) {
+            return; // 解码期间画布尺寸已变化，丢弃
+        }
+        // 键为 frame_NNNN(.png)，按名称排序即播放顺序
+        QStringList keys = loader->keys();
+        keys.sort();
+        QList<QPixmap> frames;
+        for (const QString& key : keys) {
+            QPixmap pix = QPixmap::fromImage(loader->image(key));
+            if (pix.isNull()) {
+                continue;
+            }
+            pix.setDevicePixelRatio(devicePixelRatioF());
+            frames.append(pix);
+        }
+        if (!frames.isEmpty()) {
+            insertImageSequence(sequenceName, frames);
+        } else if (!atlasPath.isEmpty()) {
+            qDebug() << "[图集] 无法读取，改用PNG序列:" << atlasPath;
+            startPngSequenceLoad(sequenceName);
+        }
     });
+    const QSize deviceSize = expressionCacheSize * devicePixelRatioF();
+    const QColor background = palette().color(QPalette::Window);
+    if (!atlasPath.isEmpty()) {
+        loader->loadAtlas(atlasPath, deviceSize, background);
+    } else {
+        loader->load(entries, deviceSize, background);
+    }
 }
+
+void Widget::insertImageSequence(const QString& sequenceName, const QList<QPixmap>& frames)
+{
+    qint64 bytes = 0;
+    for (const QPixmap& pix : frames) {
+        bytes += qint64(pix.width()) * pix.height() * pix.depth() / 8;
+    }
+    imageSequenceCache.insert(sequenceName, frames);
+    imageSequenceLru.removeAll(sequenceName);
+    imageSequenceLru.append(sequenceName);
+    imageSequenceCacheBytes += bytes;
+
+    // 超出字节上限时淘汰最久未使用的序列（至少保留刚插入的这一条）
+    while (imageSequenceCacheBytes > imageSequenceCacheLimitBytes && imageSequenceLru.size() > 1) {
+        const QString victim = imageSequenceLru.takeFirst();
+        for (const QPixmap& pix : imageSequenceCache.take(victim)) {
+            imageSequenceCacheBytes -= qint64(pix.width()) * pix.height() * pix.depth() / 8;
+        }
+        qDebug() << "[图像序列] LRU淘汰:" << victim;
+    }
+    qDebug() << "[图像序列] 已缓存:" << sequenceName << "帧数:" << frames.size()
+             << "缓存占用(MB):" << imageSequenceCacheBytes / (1024 * 1024);
+}
+
+QList<QPixmap> Widget::cachedImageSequence(const QString& sequenceName)
+{
+    auto it = imageSequenceCache.constFind(sequenceName);
+    if (it == imageSequenceCache.constEnd()) {
+        return QList<QPixmap>();
+    }
+    // 命中即移到LRU末尾
+    imageSequenceLru.removeAll(sequenceName);
+    imageSequenceLru.append(sequenceName);
+    return it.value();
+}
+
+void Widget::clearImageSequenceCache()
+{
+    imageSequenceCache.clear();
+    imageSequenceLru.clear();
+    imageSequenceCacheBytes = 0;
+}
+
 // 新增：onBlinkTimeout 实现（保持信号槽兼容）
 void Widget::onBlinkTimeout()
 {
@@ -868,19 +1201,15 @@ void Widget::onIdleTimeout()
     if (blinkTimer && blinkTimer->isActive()) {
         blinkTimer->stop();
     }
-    // 播放眨眼动画并在结束后切换为 Sleep
-    blinkOnceAsChangeExpression([this]() {
-        setExpressionBackground(ExpressionType::Sleep);
-    });
+    // 播放过渡动画并在结束后切换为 Sleep
+    transitionToExpression(ExpressionType::Sleep);
 }
 
 void Widget::resetIdleTimer()
 {
     // 若当前处于睡眠表情，则先眨眼并恢复为 Normal 状态
     if (currentExpression == ExpressionType::Sleep) {
-        blinkOnceAsChangeExpression([this]() {
-            setExpressionBackground(ExpressionType::Normal);
-        });
+        transitionToExpression(ExpressionType::Normal);
     }
 
     if (!idleTimer) return;
@@ -980,6 +1309,19 @@ void Widget::mousePressEvent(QMouseEvent *event)
     }
 }
 
+void Widget::onFaceCanvasResized(const QSize& size)
+{
+    // 按新尺寸重建缓存并刷新当前画面
+    const QSize previousSize = expressionCacheSize;
+    rebuildExpressionCache(size);
+    if (expressionCacheSize != previousSize && !isSearchingActive) {
+        const QPixmap pix = expressionPixmapCache.value(currentExpression);
+        if (!pix.isNull()) {
+            faceCanvas->setFrame(pix);
+        }
+    }
+}
+
 // ==================== Searching 动画相关函数实现 ====================
 
 void Widget::startSearchingAnimation()
@@ -990,6 +1332,9 @@ void Widget::startSearchingAnimation()
     
     isSearchingActive = true;
     currentSearchingFrame = 0;
+
+    // 丢弃未完成的眨眼/切换，避免其回调覆盖searching画面
+    frameTimeline->cancel();
     
     // 禁用所有计时器
     if (blinkTimer && blinkTimer->isActive()) {
@@ -1003,8 +1348,8 @@ void Widget::startSearchingAnimation()
     }
     
     // 启动searching动画
-    if (!searchingPixmaps[0].isNull()) {
-        faceLabel->setPixmap(searchingPixmaps[0]);
+    if (!searchingFrames[0].isNull()) {
+        faceCanvas->setFrame(searchingFrames[0]);
     }
     searchingAnimationTimer->start();
 }
@@ -1038,7 +1383,7 @@ void Widget::onSearchingAnimationTimeout()
     
     currentSearchingFrame = (currentSearchingFrame + 1) % 4;
     
-    if (!searchingPixmaps[currentSearchingFrame].isNull()) {
-        faceLabel->setPixmap(searchingPixmaps[currentSearchingFrame]);
+    if (!searchingFrames[currentSearchingFrame].isNull()) {
+        faceCanvas->setFrame(searchingFrames[currentSearchingFrame]);
     }
 }
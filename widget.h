@@ -15,20 +15,28 @@
 #include <QPixmap>
 #include <QDir>
 #include <QStringList>
+#include <QSet>
 #include <QJsonObject>
 #include <QJsonDocument>
-#include <QTcpServer>
-#include <QTcpSocket>
-#include <QNetworkInterface>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QQueue>
+#include <QPair>
 // 新增：HTTP 流式接入
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QUrl>
-// 新增：LLM显示采用QPlainTextEdit以支持滚动条
-#include <QPlainTextEdit>
 #include <QGroupBox>
 #include "interfacewidget.h"
 #include "registrationwidget.h"
+#include "faceassetloader.h"
+#include "faceatlas.h"
+#include "facecanvas.h"
+#include "overlaytextview.h"
+#include "frametimeline.h"
+#include "socketserverworker.h"
+#include "nersessionmanager.h"
+#include "llmingestqueue.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class Widget; }
@@ -93,21 +101,29 @@ public Q_SLOTS:
     // LLM/ASR 流式HTTP启动（与NerController匹配）
     void startNerStreamJson(const QUrl& baseUrl, const QString& memoryId, const QString& text);
     void startNerStreamMultipart(const QUrl& baseUrl, const QString& memoryId, const QString& imagePath);
+    // 后台预取另一会话（如用药回答），不打断当前显示；showNerSession() 切换显示
+    void prefetchNerStreamJson(const QUrl& baseUrl, const QString& memoryId, const QString& text);
+    bool showNerSession(const QString& memoryId);
+    // 指定NER后端并立即预连接（空闲后自动重连）
+    void setNerBaseUrl(const QUrl& baseUrl);
 
 Q_SIGNALS:
     // 流式文本信号：在UI线程内消费
     void llmTokens(const QString& text, bool isFinal);
     void asrText(const QString& text, bool isFinal);
+    // 表情资源异步解码完成，占位脸已替换为正式表情
+    void assetsReady();
     
 private Q_SLOTS:
     void onExpressionDurationTimeout();
+    // 资源加载线程完成后在GUI线程填充表情缓存
+    void onFaceAssetsReady();
+    void onFaceCanvasResized(const QSize& size);
 
     // LLM/ASR 显示槽
     void onLlmTokens(const QString& text, bool isFinal);
     void onTypingTick();
-    void onNerReadyRead();
-    void onNerFinished();
-    void onNerError(QNetworkReply::NetworkError code);
+    void onNerSessionShown(const QString& memoryId);
     void updateAsrText(const QString& text, bool isFinal);
 
     // 眨眼动画（带回调）：动画完成后执行回调
@@ -125,20 +141,44 @@ private:
     void cleanupAnimations();
     // 图像序列相关函数
     void preloadImageSequence(const QString& sequenceName);
+    void insertImageSequence(const QString& sequenceName, const QList<QPixmap>& frames);
+    QList<QPixmap> cachedImageSequence(const QString& sequenceName);
+    void clearImageSequenceCache();
+    QDir interpolationDir() const;
+    // 打包图集（.fatlas）：映射文件后帧直接引用映射内存，无PNG解码
+    QDir atlasDir() const;
+    bool openAtlas(FaceAtlas& atlas, const QString& path, int minFrames);
+    // 在工作线程中加载并缩放序列帧：atlasPath 非空时读图集，否则解码 entries 中的PNG
+    void startImageSequenceLoad(const QString& sequenceName, const QString& atlasPath,
+                                const QHash<QString, QString>& entries);
+    bool startPngSequenceLoad(const QString& sequenceName);
+    // 切换表情：优先播放 X_to_Y 插值序列，序列未就绪时眨眼过渡并后台预加载
+    void transitionToExpression(ExpressionType target, const std::function<void()>& after = nullptr);
+    void playTransitionFrames(const QList<TimelineFrame>& frames, const std::function<void()>& finished);
+    bool playCrossFade(ExpressionType target, const std::function<void()>& finished);
     QString expressionTypeToString(ExpressionType type);
     ExpressionType stringToExpressionType(const QString& typeString);
     EmotionOutput parseEmotionOutputJson(const QString& jsonString);
     void logEmotionTrigger(const QString& reason, ExpressionType type);
     // 根据表达类型设置背景
     void setExpressionBackground(ExpressionType type);
+    // 表情资源缓存：启动时解码一次，按画布尺寸预缩放，切换时仅替换pixmap
+    void loadExpressionSources();
+    QPixmap makePlaceholderFace() const;
+    void rebuildExpressionCache(const QSize& size);
+    QPixmap scaledToFace(const QPixmap& source) const;
+    QPixmap scaledToFace(const QImage& source) const;
+    void precomputeFaceDirtyRects();
 
-    // 更新LLM文本显示（仅保留1-2行可见，超出出现滚动条并自动滚动）
-    void updateLlmDisplay();
+    // 本帧应输出的字符数（截止时间驱动的自适应速率）
+    int llmCharsForThisTick();
+    void resetLlmPacing();
+    void appendLlmTokens(const QString& text, bool isFinal, LlmIngestQueue::Source source);
     
     Ui::Widget *ui;
     
     // 表情显示相关
-    QLabel *faceLabel;
+    FaceCanvas *faceCanvas;
     QMap<ExpressionType, QPushButton*> expressionButtons;
     QMap<ExpressionType, ExpressionData> expressions;
     QMap<ExpressionType, ExpressionParams> expressionParams;
@@ -156,23 +196,30 @@ private:
     ExpressionType toExpression;
 
     
-    // 图像序列相关成员变量
+    // 图像序列相关成员变量（按画布尺寸预缩放，LRU按字节数限额）
     QMap<QString, QList<QPixmap>> imageSequenceCache;
-    QTimer* imageAnimationTimer;
-    QStringList currentImageSequence;
-    int currentImageFrame;
+    QStringList imageSequenceLru;          // 最近使用的序列在末尾
+    qint64 imageSequenceCacheBytes;
+    qint64 imageSequenceCacheLimitBytes;
+    QHash<QString, FaceAssetLoader*> imageSequenceLoaders; // 正在后台解码的序列
+    QSet<QString> missingImageSequences;   // 不存在的序列，避免重复扫描目录
     QString interpolationBasePath;
+    QString atlasBasePath;  // searching.fatlas / blink.fatlas 所在目录
     bool useImageSequences; // 优先采用图像序列模式
     int imageAnimationIntervalMs; // 新增：图像序列播放间隔(ms)
+    // 运行时交叉淡化：无预渲染序列时混合两张缓存表情帧
+    bool useCrossFade;
+    int crossFadeDurationMs;
+    QEasingCurve crossFadeEasing;
     
     // EmotionOutput相关成员
     QTimer* expressionDurationTimer;
     EmotionOutput currentEmotionOutput;
     ExpressionType previousExpression;
     
-    // Socket服务器相关成员
-    QTcpServer* tcpServer;
-    QList<QTcpSocket*> clientSockets;
+    // Socket服务器相关成员（监听与解析在独立网络线程中进行）
+    QThread* socketThread;
+    SocketServerWorker* socketWorker;
     quint16 serverPort;
     bool isServerRunning;
 
@@ -180,41 +227,58 @@ private:
     QTimer* blinkTimer;
     QTimer* idleTimer; // 新增：空闲定时器，用于20秒无输入时切换至休眠
     QPixmap openPixmap;
-    QPixmap transitionPixmap;
-    QPixmap closedPixmap;
+    QImage transitionImage;   // 眨眼源帧：PNG解码结果或图集映射切片
+    QImage closedImage;
+    FaceAtlas blinkAtlas;     // 常驻映射，源帧直接引用其内存
+    FaceAtlas searchingAtlas;
+    // 表情背景缓存（键：ExpressionType + 当前画布尺寸）
+    QMap<ExpressionType, QPixmap> expressionSourcePixmaps; // 解码后的原图
+    QMap<ExpressionType, QPixmap> expressionPixmapCache;   // 按显示尺寸预缩放
+    QSize expressionCacheSize;
+    QPixmap blinkTransitionFrame; // 预缩放的眨眼过渡帧
+    QPixmap blinkClosedFrame;     // 预缩放的闭眼帧
+    QPixmap searchingFrames[4];   // 预缩放的searching帧
+    FrameTimeline* frameTimeline; // 眨眼/切换帧序列（单定时器）
+    FaceAssetLoader* assetLoader; // 后台解码表情资源
     // LLM/ASR 文本显示与HTTP接入成员
     QLabel* asrLabel;
-    QPlainTextEdit* llmEdit; // 替换为可滚动文本框
+    OverlayTextView* llmView; // 最近3行，逐字追加
     QLabel* llmPrefixLabel; // "机器人："固定前缀
     QNetworkAccessManager* nerNam;
-    QNetworkReply* nerReply;
-    QByteArray nerBuffer;
+    NerSessionManager* nerSessions; // 按memoryId管理的/ner流式会话
     QTimer* llmTypingTimer;
     QString llmPending;
-    QString llmDisplayed;
+    QList<QPair<LlmIngestQueue::Source, int>> llmPendingRuns; // llmPending 按来源划分的连续段（来源, 字符数）
+    LlmIngestQueue* llmIngest; // socket/HTTP 与打字显示之间的有界合并队列
     bool llmStreamFinished;
-    int llmCharsPerTick;
-    QPlainTextEdit* asrEdit; // 新增ASR编辑框指针
+    // 打字速率控制：按批次截止时间自适应每帧字符数
+    int llmTargetLatencyMs;                   // 字符从到达到上屏的目标延迟上限
+    int llmFinalDrainMs;                      // 流结束后积压全部上屏的时限
+    QElapsedTimer llmClock;
+    QQueue<QPair<qint64, qint64>> llmDeadlines; // (批次末尾字符偏移, 截止时间ms)
+    qint64 llmConsumedChars;                  // 本轮已上屏字符数
+    double llmCharCredit;                     // 小数速率累积
+    OverlayTextView* asrView; // ASR单行显示
     
     // Searching 动画相关成员
     QTimer* searchingAnimationTimer;
-    QPixmap searchingPixmaps[4];
+    QImage searchingImages[4];
     int currentSearchingFrame;
     bool isSearchingActive;
 private Q_SLOTS:
-    // Socket相关槽函数
-    void onNewConnection();
-    void onClientDisconnected();
-    void onDataReceived();
-    void onSocketError(QAbstractSocket::SocketError error);
+    // Socket相关槽函数（由网络线程排队投递）
+    void onSocketServerStateChanged(bool running, quint16 port);
+    void onSocketAsr(const QString& text, bool isFinal);
+    void onSocketEmotion(const QString& emotion);
+    // LLM入队缓冲：合并投递与背压
+    void onLlmIngestAvailable();
+    void onLlmBackpressureChanged(bool paused);
     
 private:
     // Socket相关私有函数
     void initializeSocketServer();
     void startSocketServer(quint16 port = 8888);
     void stopSocketServer();
-    void processSocketData(const QByteArray& data);
-    QString getLocalIPAddress();
     
     // Java端情感分析处理函数
     void processJavaEmotion(const QString& emotion);